@@ -0,0 +1,252 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#    include <immintrin.h>
+#    define AES_CTR_USE_AESNI_DISPATCH
+#endif
+
+// Uses AES-128 in counter mode as a random bit generator. Each block of
+// 16 bytes is the encryption of a 128 bit counter, whose lower 64 bits
+// are the block index and upper 64 bits are the stream.
+//
+// The blocks are generated in batches of 8, so that the AES-NI path can
+// keep 8 independent encryptions in flight and hide the latency of aesenc.
+// If the CPU does not support AES-NI, we fall back to a simple byte-wise
+// AES implementation, which generates the exact same sequence.
+class AesCtrEngine {
+public:
+    using result_type = std::uint64_t;
+    // The AES-NI path is hand-unrolled for exactly 8 blocks
+    static constexpr std::size_t blocks_per_batch = 8;
+    static constexpr std::size_t words_per_batch = blocks_per_batch * 16 / sizeof(result_type);
+
+    static constexpr result_type(min)() {
+        return 0;
+    }
+    static constexpr result_type(max)() {
+        return static_cast<result_type>(-1);
+    }
+
+    // Provide some default initial state for the default constructor
+    AesCtrEngine() :AesCtrEngine(0xed743cc4U) {}
+
+    // Expands the seed into the lower half of the key, the upper half
+    // is a fixed constant.
+    explicit AesCtrEngine(std::uint64_t seed, std::uint64_t stream = 0) :
+        m_stream(stream) {
+        std::uint8_t key[16];
+        const std::uint64_t upper_key = 0x9E3779B97F4A7C15ULL;
+        for (int i = 0; i < 8; ++i) {
+            key[i] = static_cast<std::uint8_t>(seed >> (8 * i));
+            key[i + 8] = static_cast<std::uint8_t>(upper_key >> (8 * i));
+        }
+        expandKey(key);
+        seek(0);
+    }
+
+    AesCtrEngine(const std::uint8_t (&key)[16], std::uint64_t stream = 0) :
+        m_stream(stream) {
+        expandKey(key);
+        seek(0);
+    }
+
+    result_type operator()() {
+        if (m_buffer_pos == words_per_batch) {
+            generateBatch(m_buffer);
+            m_buffer_pos = 0;
+        }
+        return m_buffer[m_buffer_pos++];
+    }
+
+    // Positions the generator so that the next output is the output with
+    // the given index.
+    void seek(std::uint64_t index) {
+        constexpr std::uint64_t words_per_block = 16 / sizeof(result_type);
+        m_counter = index / words_per_block;
+        m_buffer_pos = words_per_batch;
+        const auto offset = index % words_per_block;
+        if (offset != 0) {
+            // The rest of the buffer is not consumed, so we only pay for
+            // the one block we need.
+            generateBlocksPortable(m_buffer + words_per_batch - words_per_block, 1);
+            m_buffer_pos = words_per_batch - words_per_block + offset;
+        }
+    }
+
+    // Both paths write the next batch of `words_per_batch` outputs into `out`.
+    // They are exposed so that tests can check that they agree.
+    void generateBatchPortable(result_type* out) {
+        generateBlocksPortable(out, blocks_per_batch);
+    }
+
+#if defined( AES_CTR_USE_AESNI_DISPATCH )
+    __attribute__((target("aes,sse2")))
+    void generateBatchAESNI(result_type* out) {
+        __m128i round_keys[11];
+        for (int r = 0; r < 11; ++r) {
+            round_keys[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_round_keys[r]));
+        }
+        const __m128i stream = _mm_set1_epi64x(static_cast<long long>(m_stream));
+        const __m128i counter = _mm_unpacklo_epi64(_mm_set1_epi64x(static_cast<long long>(m_counter)), stream);
+        const __m128i one = _mm_set_epi64x(0, 1);
+        const __m128i two = _mm_set_epi64x(0, 2);
+
+        // The blocks are kept in separate variables rather than an array,
+        // because compilers will not unroll the loops over the array at -O2,
+        // and each round then has to wait for the previous block's result.
+        __m128i b0 = counter;
+        __m128i b1 = _mm_add_epi64(counter, one);
+        __m128i b2 = _mm_add_epi64(counter, two);
+        __m128i b3 = _mm_add_epi64(b1, two);
+        __m128i b4 = _mm_add_epi64(b2, two);
+        __m128i b5 = _mm_add_epi64(b3, two);
+        __m128i b6 = _mm_add_epi64(b4, two);
+        __m128i b7 = _mm_add_epi64(b5, two);
+
+        b0 = _mm_xor_si128(b0, round_keys[0]);
+        b1 = _mm_xor_si128(b1, round_keys[0]);
+        b2 = _mm_xor_si128(b2, round_keys[0]);
+        b3 = _mm_xor_si128(b3, round_keys[0]);
+        b4 = _mm_xor_si128(b4, round_keys[0]);
+        b5 = _mm_xor_si128(b5, round_keys[0]);
+        b6 = _mm_xor_si128(b6, round_keys[0]);
+        b7 = _mm_xor_si128(b7, round_keys[0]);
+        for (int r = 1; r < 10; ++r) {
+            b0 = _mm_aesenc_si128(b0, round_keys[r]);
+            b1 = _mm_aesenc_si128(b1, round_keys[r]);
+            b2 = _mm_aesenc_si128(b2, round_keys[r]);
+            b3 = _mm_aesenc_si128(b3, round_keys[r]);
+            b4 = _mm_aesenc_si128(b4, round_keys[r]);
+            b5 = _mm_aesenc_si128(b5, round_keys[r]);
+            b6 = _mm_aesenc_si128(b6, round_keys[r]);
+            b7 = _mm_aesenc_si128(b7, round_keys[r]);
+        }
+        __m128i* dest = reinterpret_cast<__m128i*>(out);
+        _mm_storeu_si128(dest + 0, _mm_aesenclast_si128(b0, round_keys[10]));
+        _mm_storeu_si128(dest + 1, _mm_aesenclast_si128(b1, round_keys[10]));
+        _mm_storeu_si128(dest + 2, _mm_aesenclast_si128(b2, round_keys[10]));
+        _mm_storeu_si128(dest + 3, _mm_aesenclast_si128(b3, round_keys[10]));
+        _mm_storeu_si128(dest + 4, _mm_aesenclast_si128(b4, round_keys[10]));
+        _mm_storeu_si128(dest + 5, _mm_aesenclast_si128(b5, round_keys[10]));
+        _mm_storeu_si128(dest + 6, _mm_aesenclast_si128(b6, round_keys[10]));
+        _mm_storeu_si128(dest + 7, _mm_aesenclast_si128(b7, round_keys[10]));
+        m_counter += blocks_per_batch;
+    }
+#endif
+
+private:
+    static bool hasAESNI() {
+#if defined( AES_CTR_USE_AESNI_DISPATCH )
+        static const bool has_aesni = __builtin_cpu_supports("aes");
+        return has_aesni;
+#else
+        return false;
+#endif
+    }
+
+    void generateBatch(result_type* out) {
+#if defined( AES_CTR_USE_AESNI_DISPATCH )
+        if (hasAESNI()) {
+            generateBatchAESNI(out);
+            return;
+        }
+#endif
+        generateBatchPortable(out);
+    }
+
+    void generateBlocksPortable(result_type* out, std::size_t blocks) {
+        for (std::size_t b = 0; b < blocks; ++b) {
+            std::uint8_t state[16];
+            const std::uint64_t counter = m_counter + b;
+            for (int i = 0; i < 8; ++i) {
+                state[i] = static_cast<std::uint8_t>(counter >> (8 * i));
+                state[i + 8] = static_cast<std::uint8_t>(m_stream >> (8 * i));
+            }
+            encryptBlock(state);
+            std::memcpy(out + 2 * b, state, sizeof(state));
+        }
+        m_counter += blocks;
+    }
+
+    static std::uint8_t xtime(std::uint8_t x) {
+        return static_cast<std::uint8_t>((x << 1) ^ ((x >> 7) * 0x1b));
+    }
+
+    // Plain FIPS-197 AES-128 encryption, the state is in column-major order
+    void encryptBlock(std::uint8_t (&state)[16]) const {
+        for (int i = 0; i < 16; ++i) {
+            state[i] ^= m_round_keys[0][i];
+        }
+        for (int round = 1; round < 11; ++round) {
+            // SubBytes + ShiftRows
+            std::uint8_t shifted[16];
+            for (int col = 0; col < 4; ++col) {
+                for (int row = 0; row < 4; ++row) {
+                    shifted[row + 4 * col] = s_sbox[state[row + 4 * ((col + row) % 4)]];
+                }
+            }
+            // MixColumns, skipped in the last round
+            if (round != 10) {
+                for (int col = 0; col < 4; ++col) {
+                    std::uint8_t* c = shifted + 4 * col;
+                    const std::uint8_t all = c[0] ^ c[1] ^ c[2] ^ c[3];
+                    const std::uint8_t first = c[0];
+                    c[0] ^= all ^ xtime(c[0] ^ c[1]);
+                    c[1] ^= all ^ xtime(c[1] ^ c[2]);
+                    c[2] ^= all ^ xtime(c[2] ^ c[3]);
+                    c[3] ^= all ^ xtime(c[3] ^ first);
+                }
+            }
+            for (int i = 0; i < 16; ++i) {
+                state[i] = shifted[i] ^ m_round_keys[round][i];
+            }
+        }
+    }
+
+    void expandKey(const std::uint8_t (&key)[16]) {
+        std::memcpy(m_round_keys[0], key, 16);
+        std::uint8_t rcon = 1;
+        for (int round = 1; round < 11; ++round) {
+            const std::uint8_t* prev = m_round_keys[round - 1];
+            std::uint8_t* next = m_round_keys[round];
+            // RotWord + SubWord + Rcon on the last word of previous key
+            next[0] = prev[0] ^ s_sbox[prev[13]] ^ rcon;
+            next[1] = prev[1] ^ s_sbox[prev[14]];
+            next[2] = prev[2] ^ s_sbox[prev[15]];
+            next[3] = prev[3] ^ s_sbox[prev[12]];
+            for (int i = 4; i < 16; ++i) {
+                next[i] = prev[i] ^ next[i - 4];
+            }
+            rcon = xtime(rcon);
+        }
+    }
+
+    static constexpr std::uint8_t s_sbox[256] = {
+            0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+            0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+            0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+            0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+            0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+            0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+            0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+            0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+            0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+            0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+            0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+            0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+            0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+            0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+            0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+            0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+    };
+
+    std::uint8_t m_round_keys[11][16];
+    std::uint64_t m_stream;
+    std::uint64_t m_counter;
+    result_type m_buffer[words_per_batch];
+    std::size_t m_buffer_pos;
+};
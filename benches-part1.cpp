@@ -7,12 +7,20 @@
 #include <random>
 #include <limits>
 #include <cstdint>
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <vector>
 
+#include "aes-ctr.hpp"
 #include "pcg.hpp"
 #include "distributions-lemire.hpp"
+#include "distributions-float.hpp"
+#include "engine-adapters.hpp"
+#include "generators.hpp"
 #include "inlining-blocker.hpp"
 
-template <template <typename T> class Dist> struct dist {
+template <template <typename...> class Dist> struct dist {
 	template <typename T> using type = Dist<T>;
 };
 
@@ -41,6 +49,12 @@ TEMPLATE_TEST_CASE("both distributions return the same numbers", "[reproducibili
 			REQUIRE(reuse(rng1) == noreuse(rng2));
 		}
 	}
+	SECTION("Using Philox") {
+		Philox4x32 rng1, rng2;
+		for (size_t i = 0; i < iters; ++i) {
+			REQUIRE(reuse(rng1) == noreuse(rng2));
+		}
+	}
 }
 
 TEMPLATE_TEST_CASE("std and Catch2 implement the same distribution", "[reproducibility]", dist<lemire_algorithm_reuse>, dist<lemire_algorithm_lazy_reuse>) {
@@ -57,6 +71,14 @@ TEMPLATE_TEST_CASE("std and Catch2 implement the same distribution", "[reproduci
 			REQUIRE(stddist(rng1) == catchdist(rng2));
 		}
 	}
+	SECTION("32 -> 32, Philox") {
+		Philox4x32 rng1, rng2;
+		std::uniform_int_distribution<uint32_t> stddist(0, 100'000);
+		typename TestType::type<uint32_t> catchdist(0, 100'000);
+		for (size_t i = 0; i < iters; ++i) {
+			REQUIRE(stddist(rng1) == catchdist(rng2));
+		}
+	}
 	SECTION("64 -> 64") {
 		std::mt19937_64 rng1, rng2;
 		std::uniform_int_distribution<uint64_t> stddist(0, 100'000);
@@ -67,6 +89,824 @@ TEMPLATE_TEST_CASE("std and Catch2 implement the same distribution", "[reproduci
 	}
 }
 
+template <typename IntegerType, size_t N>
+static constexpr std::array<IntegerType, N> MakeRandomTable(uint32_t seed, IntegerType a, IntegerType b) {
+	SimplePcg32 rng(seed);
+	lemire_algorithm_reuse<IntegerType> dist(a, b);
+	std::array<IntegerType, N> table{};
+	for (size_t i = 0; i < N; ++i) {
+		table[i] = dist(rng);
+	}
+	return table;
+}
+
+static constexpr auto compile_time_u32 = MakeRandomTable<uint32_t, 256>(42, 0, 999);
+static constexpr auto compile_time_u64 = MakeRandomTable<uint64_t, 256>(42, 0, 12298110947468241578ULL);
+static constexpr auto compile_time_i32 = MakeRandomTable<int32_t, 256>(42, -100, 100);
+
+// The expected values come from running the same code at runtime
+static_assert(SimplePcg32(42)() == 2334663364U, "");
+static_assert(compile_time_u32[0] == 543 && compile_time_u32[1] == 182 && compile_time_u32[7] == 598, "");
+static_assert(compile_time_u64[0] == 6685021584319358834ULL && compile_time_u64[3] == 1164087948629168195ULL, "");
+static_assert(compile_time_i32[0] == 9 && compile_time_i32[1] == -64 && compile_time_i32[5] == -87, "");
+
+template <typename T, T Bound>
+static void CheckFixedMatchesRuntime(uint32_t seed) {
+	SimplePcg32 rng1(seed), rng2(seed);
+	lemire_fixed<T, Bound> fixed;
+	lemire_algorithm_reuse<T> runtime(0, Bound);
+	for (size_t i = 0; i < 10'000; ++i) {
+		REQUIRE(fixed(rng1) == runtime(rng2));
+	}
+}
+
+template <typename T, T Bound>
+static constexpr T FirstFixed(uint32_t seed) {
+	SimplePcg32 rng(seed);
+	return lemire_fixed<T, Bound>{}(rng);
+}
+
+static_assert(FirstFixed<uint32_t, 999>(42) == compile_time_u32[0], "");
+
+TEMPLATE_TEST_CASE("fixed bound returns the same numbers as the runtime bound", "[reproducibility]", uint32_t, uint64_t) {
+	static constexpr TestType max = std::numeric_limits<TestType>::max();
+	const auto seed = std::random_device{}();
+	CAPTURE(seed);
+	CheckFixedMatchesRuntime<TestType, 1>(seed);
+	CheckFixedMatchesRuntime<TestType, 99>(seed);
+	CheckFixedMatchesRuntime<TestType, 255>(seed);
+	CheckFixedMatchesRuntime<TestType, 33554430>(seed);
+	CheckFixedMatchesRuntime<TestType, max / 2>(seed);
+	CheckFixedMatchesRuntime<TestType, max - 1>(seed);
+	CheckFixedMatchesRuntime<TestType, max>(seed);
+}
+
+TEST_CASE("compile time tables match runtime results", "[reproducibility]") {
+	auto check = [](auto const& table, auto a, auto b) {
+		using T = typename std::decay_t<decltype(table)>::value_type;
+		SimplePcg32 rng(42);
+		// The lazy variant still goes through Catch2's helpers
+		lemire_algorithm_lazy_reuse<T> dist(a, b);
+		for (auto expected : table) {
+			REQUIRE(dist(rng) == expected);
+		}
+	};
+	check(compile_time_u32, uint32_t(0), uint32_t(999));
+	check(compile_time_u64, uint64_t(0), uint64_t(12298110947468241578ULL));
+	check(compile_time_i32, int32_t(-100), int32_t(100));
+}
+
+TEMPLATE_TEST_CASE("division-free thresholds match the division", "[reproducibility]", uint8_t, uint16_t, uint32_t, uint64_t) {
+	auto check = [](TestType distance) {
+		CAPTURE(distance);
+		REQUIRE(reciprocal_threshold::compute(distance) == division_threshold::compute(distance));
+	};
+	// All of them for the 8 and 16 bit types
+	const auto max = std::numeric_limits<TestType>::max();
+	for (uint64_t i = 0; i < std::min<uint64_t>(max, 100'000); ++i) {
+		check(static_cast<TestType>(i + 1));
+		check(static_cast<TestType>(max - i));
+	}
+	if constexpr (sizeof(TestType) == sizeof(uint64_t)) {
+		// Around the switch to division
+		for (uint64_t d = (uint64_t(1) << 32) - 1'000; d < (uint64_t(1) << 32) + 1'000; ++d) {
+			check(d);
+		}
+	}
+	SimplePcg32 rng(std::random_device{}());
+	for (int i = 0; i < 100'000; ++i) {
+		const auto bits = Catch::Detail::fillBitsFrom<TestType>(rng);
+		// Small distances too, not just the ones around 2^N
+		check(std::max(TestType(1), bits));
+		check(std::max(TestType(1), static_cast<TestType>(bits >> (bits % (sizeof(TestType) * 8)))));
+	}
+}
+
+TEMPLATE_TEST_CASE("threshold table matches the division", "[reproducibility]", uint8_t, uint16_t, uint32_t, uint64_t) {
+	// Every distance in the table, and a few past it, which use the fallback
+	const auto last = std::min<uint64_t>(std::numeric_limits<TestType>::max(), 65'536 + 100);
+	for (uint64_t d = 1; d <= last; ++d) {
+		const auto distance = static_cast<TestType>(d);
+		CAPTURE(distance);
+		REQUIRE(small_table_threshold<>::compute(distance) == division_threshold::compute(distance));
+	}
+	static_assert(small_table_threshold<>::compute(uint64_t(7)) == division_threshold::compute(uint64_t(7)),
+	              "The table is usable in constant expressions");
+}
+
+TEST_CASE("AES-CTR matches the FIPS-197 example and both paths agree", "[reproducibility]") {
+	const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	                          0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+	SECTION("FIPS-197 C.1") {
+		// The plaintext 00112233445566778899aabbccddeeff, read as little endian counter
+		AesCtrEngine rng(key, 0xffeeddccbbaa9988);
+		rng.seek(0x7766554433221100ULL * 2);
+		// Ciphertext 69c4e0d86a7b0430d8cdb78070b4c55a, read as little endian words
+		REQUIRE(rng() == 0x30047b6ad8e0c469ULL);
+		REQUIRE(rng() == 0x5ac5b47080b7cdd8ULL);
+	}
+#if defined( AES_CTR_USE_AESNI_DISPATCH )
+	SECTION("AES-NI and portable paths") {
+		if (__builtin_cpu_supports("aes")) {
+			AesCtrEngine rng1(key, 42), rng2(key, 42);
+			uint64_t portable[AesCtrEngine::words_per_batch], aesni[AesCtrEngine::words_per_batch];
+			for (size_t batch = 0; batch < 1'000; ++batch) {
+				rng1.generateBatchPortable(portable);
+				rng2.generateBatchAESNI(aesni);
+				REQUIRE(std::equal(std::begin(portable), std::end(portable), std::begin(aesni)));
+			}
+		}
+	}
+#endif
+	SECTION("seek") {
+		AesCtrEngine sequential(key), seeked(key);
+		for (int i = 0; i < 37; ++i) {
+			sequential();
+		}
+		seeked.seek(37);
+		for (int i = 0; i < 100; ++i) {
+			REQUIRE(sequential() == seeked());
+		}
+	}
+}
+
+TEST_CASE("xoshiro256++ matches the reference implementation", "[reproducibility]") {
+	Xoshiro256PlusPlus rng(1, 2, 3, 4);
+	REQUIRE(rng() == 41943041);
+}
+
+// The expected values come from running PractRand's sfc64, wyhash's wyrand
+// and Lemire's lehmer64 from the same seed. lehmer64 is started from the
+// state Lehmer128 derives from the seed, because their seeding differs.
+TEST_CASE("sfc64 matches the reference implementation", "[reproducibility]") {
+	Sfc64 rng(42);
+	REQUIRE(rng() == 9593766767639209231ULL);
+	REQUIRE(rng() == 7993095875549472148ULL);
+	REQUIRE(rng() == 7611607860230059198ULL);
+}
+
+TEST_CASE("wyrand matches the reference implementation", "[reproducibility]") {
+	WyRand rng(42);
+	REQUIRE(rng() == 12558987674375533620ULL);
+	REQUIRE(rng() == 16846851108956068306ULL);
+	REQUIRE(rng() == 14652274819296609082ULL);
+}
+
+#if defined( USE_UINT128 )
+TEST_CASE("Lehmer128 matches the reference implementation", "[reproducibility]") {
+	Lehmer128 rng(42);
+	REQUIRE(rng() == 4298048059008371034ULL);
+	REQUIRE(rng() == 14666044600434061271ULL);
+	REQUIRE(rng() == 3973085874538543620ULL);
+}
+#endif
+
+TEST_CASE("bit pool hands out all bits of the engine", "[reproducibility]") {
+	const uint64_t seed = std::random_device{}();
+	CAPTURE(seed);
+	Xoshiro256PlusPlus rng(seed);
+	bit_pool<Xoshiro256PlusPlus> pool(Xoshiro256PlusPlus{seed});
+	SECTION("32 bit requests") {
+		for (size_t i = 0; i < 1'000; ++i) {
+			const uint64_t expected = rng();
+			const uint64_t upper = pool();
+			const uint64_t lower = pool();
+			REQUIRE(((upper << 32) | lower) == expected);
+		}
+	}
+	SECTION("mixed width requests") {
+		for (size_t i = 0; i < 1'000; ++i) {
+			const uint64_t first = rng();
+			const uint64_t second = rng();
+			// 8 + 16 + 64 + 32 + 8 = 128 bits
+			REQUIRE(pool.take<uint8_t>() == first >> 56);
+			REQUIRE(pool.take<uint16_t>() == ((first >> 40) & 0xFFFF));
+			REQUIRE(pool.take<uint64_t>() == ((first << 24) | (second >> 40)));
+			REQUIRE(pool.take<uint32_t>() == ((second >> 8) & 0xFFFF'FFFF));
+			REQUIRE(pool.take<uint8_t>() == (second & 0xFF));
+		}
+	}
+}
+
+TEST_CASE("multi-lane PCG returns the same numbers from all paths", "[reproducibility]") {
+	static constexpr size_t words = 10'000;
+	MultiLanePcg32 rng1, rng2, rng3;
+	std::vector<uint32_t> scalar(words), simd(words), filled(words);
+	rng1.generateBlocksScalar(scalar.data(), words / MultiLanePcg32::lanes);
+#if defined( PCG_USE_AVX2_DISPATCH )
+	if (__builtin_cpu_supports("avx2")) {
+		rng2.generateBlocksAVX2(simd.data(), words / MultiLanePcg32::lanes);
+		REQUIRE(scalar == simd);
+	}
+#endif
+	// Uneven chunks force fill to go through the buffered path as well
+	for (size_t done = 0; done < words;) {
+		const size_t chunk = std::min(words - done, size_t(37));
+		rng3.fill(filled.data() + done, chunk);
+		done += chunk;
+	}
+	REQUIRE(scalar == filled);
+
+	MultiLanePcg32 rng4;
+	for (size_t i = 0; i < words; ++i) {
+		REQUIRE(rng4() == scalar[i]);
+	}
+
+	for (size_t lane = 0; lane < MultiLanePcg32::lanes; ++lane) {
+		auto single = MultiLanePcg32::laneEngine(0xed743cc4U, lane);
+		for (size_t i = lane; i < words; i += MultiLanePcg32::lanes) {
+			REQUIRE(single() == scalar[i]);
+		}
+	}
+}
+
+TEST_CASE("PCG jump-ahead matches naive discarding", "[reproducibility]") {
+	const auto seed = std::random_device{}();
+	const uint64_t stream = std::random_device{}();
+	CAPTURE(seed, stream);
+	auto distance = GENERATE(as<uint64_t>{}, 0, 1, 2, 3, 100, 12'345, 1'000'000);
+	CAPTURE(distance);
+
+	SimplePcg32 naive(seed, stream), jumped(seed, stream);
+	for (uint64_t i = 0; i < distance; ++i) {
+		naive();
+	}
+	jumped.advance(distance);
+	for (size_t i = 0; i < 1'000; ++i) {
+		REQUIRE(naive() == jumped());
+	}
+
+	SECTION("advancing backwards undoes advancing forward") {
+		SimplePcg32 fresh(seed, stream), returned(seed, stream);
+		returned.discard(distance);
+		returned.advance(-distance);
+		for (size_t i = 0; i < 1'000; ++i) {
+			REQUIRE(fresh() == returned());
+		}
+	}
+}
+
+TEST_CASE("PCG streams are independent sequences", "[reproducibility]") {
+	SimplePcg32 rng1(42, 1), rng2(42, 2);
+	size_t same_outputs = 0;
+	for (size_t i = 0; i < 1'000; ++i) {
+		same_outputs += rng1() == rng2();
+	}
+	REQUIRE(same_outputs < 10);
+}
+
+TEST_CASE("Philox matches the known answer vectors", "[reproducibility]") {
+	// Taken from Random123's kat_vectors
+	struct kat {
+		uint32_t key[2];
+		uint64_t block, stream;
+		uint32_t expected[4];
+	};
+	const kat vectors[] = {
+		{ { 0, 0 }, 0, 0, { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+		{ { 0xffffffff, 0xffffffff },
+		  0xffffffff'ffffffff,
+		  0xffffffff'ffffffff,
+		  { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+		{ { 0xa4093822, 0x299f31d0 },
+		  0x85a308d3'243f6a88,
+		  0x03707344'13198a2e,
+		  { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+	};
+	for (auto const& vec : vectors) {
+		uint32_t out[4];
+		Philox4x32::generateBlock(vec.key, vec.block, vec.stream, out);
+		for (size_t i = 0; i < 4; ++i) {
+			REQUIRE(out[i] == vec.expected[i]);
+		}
+	}
+}
+
+TEST_CASE("Philox can start at any output index", "[reproducibility]") {
+	static constexpr size_t words = 1'000;
+	Philox4x32 sequential(12345, 6);
+	std::vector<uint32_t> expected(words);
+	for (auto& word : expected) {
+		word = sequential();
+	}
+
+	auto start = GENERATE(as<uint64_t>{}, 0, 1, 2, 3, 4, 5, 17, 500);
+	CAPTURE(start);
+	SECTION("seek") {
+		Philox4x32 rng(12345, 6);
+		rng.seek(start);
+		REQUIRE(rng.position() == start);
+		for (size_t i = start; i < words; ++i) {
+			REQUIRE(rng() == expected[i]);
+		}
+	}
+	SECTION("discard and fill") {
+		Philox4x32 rng(12345, 6);
+		rng();
+		rng.discard(start);
+		REQUIRE(rng.position() == start + 1);
+		std::vector<uint32_t> filled(words - start - 1);
+		rng.fill(filled.data(), filled.size());
+		REQUIRE(std::equal(filled.begin(), filled.end(), expected.begin() + start + 1));
+	}
+}
+
+TEMPLATE_TEST_CASE("bulk generation returns numbers from the distribution", "[distributions]",
+	dist<lemire_algorithm_no_reuse>, dist<lemire_algorithm_reuse>, dist<lemire_algorithm_lazy_reuse>) {
+	static constexpr size_t count = 100'000;
+	const auto seed = std::random_device{}();
+	CAPTURE(seed);
+	SimplePcg32 rng(seed);
+
+	SECTION("signed bounds") {
+		typename TestType::type<int32_t> dist(-100, 100);
+		std::vector<int32_t> out(count);
+		dist.generate(out.begin(), out.end(), rng);
+		for (auto x : out) {
+			REQUIRE(x >= -100);
+			REQUIRE(x <= 100);
+		}
+	}
+	SECTION("full range") {
+		using limits = std::numeric_limits<int64_t>;
+		typename TestType::type<int64_t> dist((limits::min)(), (limits::max)());
+		std::vector<int64_t> out(count);
+		dist.generate(out.begin(), out.end(), rng);
+		// With the full range, nothing is rejected and the order matches
+		SimplePcg32 rng2(seed);
+		typename TestType::type<int64_t> dist2((limits::min)(), (limits::max)());
+		for (auto x : out) {
+			REQUIRE(x == dist2(rng2));
+		}
+	}
+	SECTION("power of two distance matches repeated calls") {
+		// The threshold is 0 for these, so nothing is rejected either
+		typename TestType::type<uint32_t> dist(10, 10 + 255);
+		std::vector<uint32_t> out(count);
+		dist.generate(out.begin(), out.end(), rng);
+		SimplePcg32 rng2(seed);
+		typename TestType::type<uint32_t> dist2(10, 10 + 255);
+		for (auto x : out) {
+			REQUIRE(x == dist2(rng2));
+		}
+	}
+	SECTION("uniformity sanity check") {
+		// 2^32 % 10 != 0, so some numbers do get rejected here
+		static constexpr size_t buckets = 10;
+		typename TestType::type<uint32_t> dist(0, buckets - 1);
+		std::vector<uint32_t> out(count);
+		dist.generate(out.begin(), out.end(), rng);
+		size_t counts[buckets] = {};
+		for (auto x : out) {
+			REQUIRE(x < buckets);
+			++counts[x];
+		}
+		for (auto c : counts) {
+			REQUIRE(c > count / buckets * 9 / 10);
+			REQUIRE(c < count / buckets * 11 / 10);
+		}
+	}
+}
+
+TEST_CASE("32 bit bulk Lemire returns the same numbers as repeated calls", "[reproducibility]") {
+	static constexpr size_t count = 10'000;
+	const auto seed = std::random_device{}();
+	CAPTURE(seed);
+	auto bound = GENERATE(as<uint32_t>{}, 100, float_bound(uint32_t{}), std::numeric_limits<uint32_t>::max() - 1);
+	CAPTURE(bound);
+
+	auto check = [&](auto rng1, auto rng2) {
+		lemire_algorithm_reuse<uint32_t> dist(0, bound);
+		std::vector<uint32_t> out(count);
+		dist.generate(out.begin(), out.end(), rng1);
+		for (auto x : out) {
+			REQUIRE(x == dist(rng2));
+		}
+		// Both generators must also have used up the same numbers
+		REQUIRE(rng1() == rng2());
+	};
+	SECTION("Using PCG") {
+		check(SimplePcg32(seed), SimplePcg32(seed));
+	}
+	SECTION("Using multi-lane PCG, with bulk fill") {
+		check(MultiLanePcg32(seed), MultiLanePcg32(seed));
+	}
+	SECTION("Using MT_64") {
+		check(std::mt19937_64(seed), std::mt19937_64(seed));
+	}
+	SECTION("Signed type") {
+		lemire_algorithm_reuse<int32_t> dist(-1'000, 1'000);
+		SimplePcg32 rng1(seed), rng2(seed);
+		std::vector<int32_t> out(count);
+		dist.generate(out.begin(), out.end(), rng1);
+		for (auto x : out) {
+			REQUIRE(x == dist(rng2));
+		}
+	}
+	SECTION("Signed type into an unsigned buffer") {
+		// Raw pointers to the unsigned type take the in-place path
+		lemire_algorithm_reuse<int32_t> dist(-100, 100);
+		MultiLanePcg32 rng1(seed), rng2(seed);
+		std::vector<uint32_t> out(count);
+		dist.generate(out.data(), out.data() + count, rng1);
+		for (auto x : out) {
+			REQUIRE(x == static_cast<uint32_t>(dist(rng2)));
+		}
+	}
+}
+
+TEST_CASE("64 bit bulk Lemire returns the same numbers as repeated calls", "[reproducibility]") {
+	static constexpr size_t count = 10'000;
+	const auto seed = std::random_device{}();
+	CAPTURE(seed);
+	// The last two bounds reject often enough to use the filtered path
+	// even without a bulk fill
+	auto bound = GENERATE(as<uint64_t>{}, 100, float_bound(uint64_t{}), std::numeric_limits<uint64_t>::max() - 1,
+		12298110947468241578ULL, std::numeric_limits<uint64_t>::max() / 2 + 1);
+	CAPTURE(bound);
+
+	auto check = [&](auto rng1, auto rng2) {
+		lemire_algorithm_reuse<uint64_t> dist(0, bound);
+		std::vector<uint64_t> out(count);
+		dist.generate(out.begin(), out.end(), rng1);
+		for (auto x : out) {
+			REQUIRE(x == dist(rng2));
+		}
+		REQUIRE(rng1() == rng2());
+	};
+	SECTION("Using PCG") {
+		check(SimplePcg32(seed), SimplePcg32(seed));
+	}
+	SECTION("Using multi-lane PCG, with bulk fill") {
+		check(MultiLanePcg32(seed), MultiLanePcg32(seed));
+	}
+	SECTION("Using MT_64") {
+		check(std::mt19937_64(seed), std::mt19937_64(seed));
+	}
+	SECTION("long long, which is not the same type as int64_t") {
+		MultiLanePcg32 rng1(seed), rng2(seed);
+		lemire_algorithm_reuse<unsigned long long> dist(0, bound);
+		std::vector<unsigned long long> out(count);
+		dist.generate(out.data(), out.data() + count, rng1);
+		for (auto x : out) {
+			REQUIRE(x == dist(rng2));
+		}
+		lemire_algorithm_reuse<long long> signed_dist(-100, 100);
+		std::vector<unsigned long long> signed_out(count);
+		signed_dist.generate(signed_out.data(), signed_out.data() + count, rng1);
+		for (auto x : signed_out) {
+			REQUIRE(x == static_cast<unsigned long long>(signed_dist(rng2)));
+		}
+	}
+}
+
+#if defined( BULK_USE_AVX2_DISPATCH )
+TEST_CASE("AVX2 and scalar Lemire filters agree", "[reproducibility]") {
+	if (__builtin_cpu_supports("avx2")) {
+		// Not a multiple of 8, so that the scalar tail gets used too
+		static constexpr size_t count = 1'003;
+		auto bound = GENERATE(as<uint32_t>{}, 1, 100, 1'000'000, float_bound(uint32_t{}), std::numeric_limits<uint32_t>::max() - 1);
+		CAPTURE(bound);
+		const uint32_t distance = bound + 1;
+		const uint32_t threshold = (~distance + 1) % distance;
+
+		SimplePcg32 rng(std::random_device{}());
+		std::vector<uint32_t> bits(count);
+		for (auto& b : bits) {
+			b = rng();
+		}
+		std::vector<uint32_t> scalar(count), avx2(count);
+		const auto scalar_count = detail::lemireFilter32Scalar(bits.data(), count, 7, distance, threshold, scalar.data());
+		const auto avx2_count = detail::lemireFilter32AVX2(bits.data(), count, 7, distance, threshold, avx2.data());
+		REQUIRE(scalar_count == avx2_count);
+		REQUIRE(std::equal(scalar.begin(), scalar.begin() + scalar_count, avx2.begin()));
+	}
+}
+#endif
+
+#if defined( BULK_USE_AVX2_DISPATCH )
+TEST_CASE("AVX-512 and scalar 64 bit Lemire filters agree", "[reproducibility]") {
+	if (__builtin_cpu_supports("avx512f")) {
+		// Not a multiple of 8, so that the masked tail gets used too
+		static constexpr size_t count = 1'005;
+		auto bound = GENERATE(as<uint64_t>{}, 1, 100, float_bound(uint64_t{}), uint64_t(1) << 40,
+			12298110947468241578ULL, std::numeric_limits<uint64_t>::max() - 1);
+		CAPTURE(bound);
+		const uint64_t distance = bound + 1;
+		const uint64_t threshold = (~distance + 1) % distance;
+
+		std::mt19937_64 rng(std::random_device{}());
+		std::vector<uint64_t> bits(count);
+		for (auto& b : bits) {
+			b = rng();
+		}
+		std::vector<uint64_t> scalar(count), avx512(count);
+		const auto scalar_count = detail::lemireFilter64Scalar(bits.data(), count, 7, distance, threshold, scalar.data());
+		const auto avx512_count = detail::lemireFilter64AVX512(bits.data(), count, 7, distance, threshold, avx512.data());
+		REQUIRE(scalar_count == avx512_count);
+		REQUIRE(std::equal(scalar.begin(), scalar.begin() + scalar_count, avx512.begin()));
+	}
+}
+#endif
+
+TEMPLATE_TEST_CASE("uniform real distribution returns numbers from the range", "[distributions]", float, double) {
+	static constexpr size_t count = 10'000;
+	const auto seed = std::random_device{}();
+	CAPTURE(seed);
+	const auto bounds = GENERATE(table<TestType, TestType>({
+		{ TestType(0), TestType(1) },
+		{ TestType(-1), TestType(1) },
+		{ TestType(-5), TestType(0.001) },
+		{ TestType(0.001), TestType(1000) },
+		{ TestType(3), TestType(3) },
+		{ std::numeric_limits<TestType>::lowest(), std::numeric_limits<TestType>::max() } }));
+	const auto a = std::get<0>(bounds);
+	const auto b = std::get<1>(bounds);
+	CAPTURE(a, b);
+
+	lemire_uniform_real<TestType> dist(a, b);
+	SimplePcg32 rng(seed);
+	std::vector<TestType> out(count);
+	dist.generate(out.begin(), out.end(), rng);
+	for (size_t i = 0; i < count; ++i) {
+		const auto x = dist(rng);
+		REQUIRE(a <= x);
+		REQUIRE(x <= b);
+		REQUIRE(a <= out[i]);
+		REQUIRE(out[i] <= b);
+	}
+}
+
+TEMPLATE_TEST_CASE("uniform real distribution returns both endpoints", "[distributions]", float, double) {
+	// The range has exactly 3 floats, so all of them should come up
+	const TestType a = 1;
+	const TestType b = std::nextafter(std::nextafter(a, TestType(2)), TestType(2));
+	lemire_uniform_real<TestType> dist(a, b);
+	SimplePcg32 rng(std::random_device{}());
+	int seen[3] = {};
+	for (int i = 0; i < 1'000; ++i) {
+		const auto x = dist(rng);
+		REQUIRE((x == a || x == std::nextafter(a, b) || x == b));
+		++seen[x == a ? 0 : x == b ? 2 : 1];
+	}
+	REQUIRE(seen[0] > 0);
+	REQUIRE(seen[1] > 0);
+	REQUIRE(seen[2] > 0);
+}
+
+TEMPLATE_TEST_CASE("bulk uniform real returns the same numbers as repeated calls", "[reproducibility]", float, double) {
+	// Not a multiple of the chunk size, nor of the SIMD width
+	static constexpr size_t count = 10'003;
+	const auto seed = std::random_device{}();
+	CAPTURE(seed);
+	const auto bounds = GENERATE(table<TestType, TestType>({
+		{ TestType(0), TestType(1) },
+		{ TestType(-1), TestType(1) },
+		{ TestType(-1000), TestType(-0.5) },
+		{ TestType(3), TestType(3) },
+		// Too wide to convert in a single step
+		{ std::numeric_limits<TestType>::lowest(), std::numeric_limits<TestType>::max() } }));
+	const auto a = std::get<0>(bounds);
+	const auto b = std::get<1>(bounds);
+	CAPTURE(a, b);
+
+	auto check = [&](auto rng1, auto rng2) {
+		lemire_uniform_real<TestType> dist(a, b);
+		std::vector<TestType> out(count);
+		dist.generate(out.data(), out.data() + count, rng1);
+		for (auto x : out) {
+			REQUIRE(x == dist(rng2));
+		}
+		REQUIRE(rng1() == rng2());
+	};
+	SECTION("Using PCG") {
+		check(SimplePcg32(seed), SimplePcg32(seed));
+	}
+	SECTION("Using multi-lane PCG, with bulk fill") {
+		check(MultiLanePcg32(seed), MultiLanePcg32(seed));
+	}
+	SECTION("Non-pointer output") {
+		lemire_uniform_real<TestType> dist(a, b);
+		SimplePcg32 rng1(seed), rng2(seed);
+		std::deque<TestType> out(count);
+		dist.generate(out.begin(), out.end(), rng1);
+		for (auto x : out) {
+			REQUIRE(x == dist(rng2));
+		}
+	}
+}
+
+#if defined( BULK_USE_AVX2_DISPATCH )
+TEST_CASE("AVX2 and scalar step conversions agree", "[reproducibility]") {
+	if (__builtin_cpu_supports("avx2")) {
+		// Not a multiple of 8, so that the scalar tail gets used too
+		static constexpr size_t count = 1'003;
+		SimplePcg32 rng(std::random_device{}());
+		SECTION("float") {
+			const uint32_t last_step = float_bound(uint32_t{});
+			std::vector<uint32_t> steps(count);
+			for (auto& s : steps) {
+				s = rng() % (last_step + 1);
+			}
+			steps[5] = last_step;
+			std::vector<float> scalar(count), avx2(count);
+			detail::stepsToFloatingScalar(steps.data(), count, 7.f, -0x1p-21f, last_step, -3.f, scalar.data());
+			detail::stepsToFloatAVX2(steps.data(), count, 7.f, -0x1p-21f, last_step, -3.f, avx2.data());
+			REQUIRE(scalar == avx2);
+			REQUIRE(avx2[5] == -3.f);
+		}
+		SECTION("double") {
+			const uint64_t last_step = float_bound(uint64_t{});
+			std::vector<uint64_t> steps(count);
+			for (auto& s : steps) {
+				s = Catch::Detail::fillBitsFrom<uint64_t>(rng) % (last_step + 1);
+			}
+			steps[5] = last_step;
+			// Steps above 2^53 are rounded by the conversion
+			steps[6] = last_step - 1;
+			std::vector<double> scalar(count), avx2(count);
+			detail::stepsToFloatingScalar(steps.data(), count, 7., -0x1p-50, last_step, -3., scalar.data());
+			detail::stepsToDoubleAVX2(steps.data(), count, 7., -0x1p-50, last_step, -3., avx2.data());
+			REQUIRE(scalar == avx2);
+			REQUIRE(avx2[5] == -3.);
+		}
+	}
+}
+#endif
+
+TEST_CASE("batched distribution draws several numbers per generator call", "[distributions]") {
+	// Counts how often the distribution asks for random bits
+	struct CountingPcg {
+		using result_type = uint32_t;
+		static constexpr result_type (min)() { return 0; }
+		static constexpr result_type (max)() { return static_cast<result_type>(-1); }
+		SimplePcg32 pcg;
+		size_t calls = 0;
+		result_type operator()() {
+			++calls;
+			return pcg();
+		}
+	};
+	CountingPcg rng{ SimplePcg32(std::random_device{}()) };
+
+	SECTION("bound of 100") {
+		static constexpr size_t count = 90'000;
+		lemire_batched<uint32_t> dist(0, 99);
+		size_t counts[100] = {};
+		for (size_t i = 0; i < count; ++i) {
+			auto x = dist(rng);
+			REQUIRE(x < 100);
+			++counts[x];
+		}
+		// 9 numbers per 64 bit number, which is 2 calls to PCG32, and
+		// about 2.4% of the batches are rejected
+		REQUIRE(rng.calls <= count / 9 * 2 * 105 / 100);
+		for (auto c : counts) {
+			REQUIRE(c > count / 100 * 8 / 10);
+			REQUIRE(c < count / 100 * 12 / 10);
+		}
+	}
+	SECTION("signed type") {
+		lemire_batched<int32_t> dist(-3, 3);
+		for (size_t i = 0; i < 10'000; ++i) {
+			auto x = dist(rng);
+			REQUIRE(x >= -3);
+			REQUIRE(x <= 3);
+		}
+	}
+	SECTION("single value") {
+		lemire_batched<uint64_t> dist(42, 42);
+		for (size_t i = 0; i < 1'000; ++i) {
+			REQUIRE(dist(rng) == 42);
+		}
+	}
+	SECTION("full range") {
+		using limits = std::numeric_limits<uint64_t>;
+		lemire_batched<uint64_t> dist((limits::min)(), (limits::max)());
+		SimplePcg32 rng1(1), rng2(1);
+		for (size_t i = 0; i < 1'000; ++i) {
+			REQUIRE(dist(rng1) == Catch::Detail::fillBitsFrom<uint64_t>(rng2));
+		}
+	}
+}
+
+TEST_CASE("batched shuffle returns uniform permutations", "[distributions]") {
+	const auto seed = std::random_device{}();
+	CAPTURE(seed);
+	SimplePcg32 rng(seed);
+
+	SECTION("all permutations of 4 elements") {
+		static constexpr size_t runs = 240'000;
+		std::array<int, 4> base = { 0, 1, 2, 3 };
+		std::vector<std::array<int, 4>> permutations;
+		do {
+			permutations.push_back(base);
+		} while (std::next_permutation(base.begin(), base.end()));
+		REQUIRE(permutations.size() == 24);
+
+		size_t counts[24] = {};
+		for (size_t i = 0; i < runs; ++i) {
+			std::array<int, 4> arr = { 0, 1, 2, 3 };
+			batched_shuffle(arr.begin(), arr.end(), rng);
+			auto it = std::find(permutations.begin(), permutations.end(), arr);
+			REQUIRE(it != permutations.end());
+			++counts[it - permutations.begin()];
+		}
+		for (auto c : counts) {
+			REQUIRE(c > runs / 24 * 9 / 10);
+			REQUIRE(c < runs / 24 * 11 / 10);
+		}
+	}
+	SECTION("large inputs stay permutations") {
+		// Large enough to go through all batch sizes but 1
+		auto size = GENERATE(as<size_t>{}, 0, 1, 2, 7, 1'500, 100'000, 3'000'000);
+		CAPTURE(size);
+		std::vector<uint32_t> values(size);
+		for (size_t i = 0; i < size; ++i) {
+			values[i] = static_cast<uint32_t>(i);
+		}
+		batched_shuffle(values.begin(), values.end(), rng);
+		std::sort(values.begin(), values.end());
+		for (size_t i = 0; i < size; ++i) {
+			REQUIRE(values[i] == i);
+		}
+	}
+}
+
+// Fills the output in chunks, so that we do not need to allocate memory for
+// all the iterations.
+template <typename TestType, typename Generator>
+static TestType SumFilledWords(Generator& rng, size_t iters) {
+	static constexpr size_t chunk_size = 4096;
+	static_assert(sizeof(TestType) % sizeof(uint32_t) == 0, "");
+	uint32_t chunk[chunk_size];
+	TestType sum = 0;
+	size_t words = iters * (sizeof(TestType) / sizeof(uint32_t));
+	while (words > 0) {
+		const size_t now = std::min(words, chunk_size);
+		rng.fill(chunk, now);
+		for (size_t i = 0; i < now; ++i) {
+			sum += chunk[i];
+		}
+		words -= now;
+	}
+	return sum;
+}
+
+// Like SumFilledWords, but fills the chunks through the distribution's
+// bulk API.
+template <typename TestType, typename Distribution, typename Generator>
+static TestType SumBulkGenerated(Distribution& dist, Generator& rng, size_t iters) {
+	static constexpr size_t chunk_size = 4096;
+	TestType chunk[chunk_size];
+	TestType sum = 0;
+	while (iters > 0) {
+		const size_t now = std::min(iters, chunk_size);
+		dist.generate(chunk, chunk + now, rng);
+		for (size_t i = 0; i < now; ++i) {
+			sum += chunk[i];
+		}
+		iters -= now;
+	}
+	return sum;
+}
+
+template <typename TestType, typename Generator>
+static void BenchmarkPlainGenerator(std::string const& name, size_t iters) {
+	Generator rng;
+	BENCHMARK("plain " + name + " generator, iters=" + std::to_string(iters)) {
+		TestType sum = 0;
+		for (size_t n = 0; n < iters; ++n) {
+			sum += Catch::Detail::fillBitsFrom<TestType>(rng);
+		}
+		return sum;
+	};
+}
+
+template <typename TestType, typename Generator>
+static void BenchmarkGeneratorFill(std::string const& name, size_t iters) {
+	Generator rng;
+	BENCHMARK(name + " generator fill, iters=" + std::to_string(iters)) {
+		return SumFilledWords<TestType>(rng, iters);
+	};
+}
+
+TEST_CASE("jump-ahead bench", "[!benchmark]") {
+	auto distance = GENERATE(as<uint64_t>{}, 1'000, 100'000, 10'000'000);
+
+	SimplePcg32 rng;
+	BENCHMARK("naive discard, distance=" + std::to_string(distance)) {
+		for (uint64_t n = 0; n < distance; ++n) {
+			rng();
+		}
+		return rng();
+	};
+	BENCHMARK("advance, distance=" + std::to_string(distance)) {
+		rng.advance(distance);
+		return rng();
+	};
+}
+
 TEMPLATE_TEST_CASE("no-reuse bench", "[!benchmark]", uint32_t, uint64_t) {
 	size_t iters = GENERATE(100'000, 1'000'000, 10'000'000);
 
@@ -78,6 +918,11 @@ TEMPLATE_TEST_CASE("no-reuse bench", "[!benchmark]", uint32_t, uint64_t) {
 				sum += Catch::Detail::fillBitsFrom<TestType>(rng);
 			}
 		};
+		BenchmarkPlainGenerator<TestType, MultiLanePcg32>("multi-lane", iters);
+		BenchmarkGeneratorFill<TestType, MultiLanePcg32>("multi-lane", iters);
+		BenchmarkPlainGenerator<TestType, Philox4x32>("Philox", iters);
+		BenchmarkGeneratorFill<TestType, Philox4x32>("Philox", iters);
+		BenchmarkPlainGenerator<TestType, AesCtrEngine>("AES-CTR", iters);
 	}
 	SECTION("noreuse") {
 		BENCHMARK("noreuse, iters=" + std::to_string(iters)) {
@@ -109,6 +954,24 @@ TEMPLATE_TEST_CASE("no-reuse bench", "[!benchmark]", uint32_t, uint64_t) {
 			return sum;
 		};
 	}
+	SECTION("division-free threshold") {
+		BENCHMARK("noreuse with reciprocal threshold, iters=" + std::to_string(iters)) {
+			TestType sum = 0;
+			for (size_t high_now = 0; high_now < iters; ++high_now) {
+				lemire_algorithm_no_reuse<TestType, reciprocal_threshold> dist(0, high_now);
+				sum += dist(rng);
+			}
+			return sum;
+		};
+		BENCHMARK("reuse with reciprocal threshold, iters=" + std::to_string(iters)) {
+			TestType sum = 0;
+			for (size_t high_now = 0; high_now < iters; ++high_now) {
+				lemire_algorithm_reuse<TestType, reciprocal_threshold> dist(0, high_now);
+				sum += dist(rng);
+			}
+			return sum;
+		};
+	}
 }
 
 template <typename TestType>
@@ -122,6 +985,11 @@ static void RunBenchmarksWithPremadeDistributions(TestType right_bound, size_t i
 				sum += Catch::Detail::fillBitsFrom<TestType>(rng);
 			}
 		};
+		BenchmarkPlainGenerator<TestType, MultiLanePcg32>("multi-lane", iters);
+		BenchmarkGeneratorFill<TestType, MultiLanePcg32>("multi-lane", iters);
+		BenchmarkPlainGenerator<TestType, Philox4x32>("Philox", iters);
+		BenchmarkGeneratorFill<TestType, Philox4x32>("Philox", iters);
+		BenchmarkPlainGenerator<TestType, AesCtrEngine>("AES-CTR", iters);
 	}
 	SECTION("noreuse") {
 		BENCHMARK("noreuse, iters=" + std::to_string(iters)) {
@@ -142,6 +1010,15 @@ static void RunBenchmarksWithPremadeDistributions(TestType right_bound, size_t i
 			}
 			return sum;
 		};
+		AesCtrEngine aes_rng;
+		BENCHMARK("reuse with AES-CTR generator, iters=" + std::to_string(iters)) {
+			TestType sum = 0;
+			lemire_algorithm_reuse<TestType> dist(0, same(right_bound));
+			for (size_t n = 0; n < iters; ++n) {
+				sum += dist(aes_rng);
+			}
+			return sum;
+		};
 	}
 	SECTION("lazy-reuse") {
 		BENCHMARK("lazy-reuse, iters=" + std::to_string(iters)) {
@@ -153,6 +1030,30 @@ static void RunBenchmarksWithPremadeDistributions(TestType right_bound, size_t i
 			return sum;
 		};
 	}
+	SECTION("batched") {
+		BENCHMARK("batched, iters=" + std::to_string(iters)) {
+			TestType sum = 0;
+			lemire_batched<TestType> dist(0, same(right_bound));
+			for (size_t n = 0; n < iters; ++n) {
+				sum += dist(rng);
+			}
+			return sum;
+		};
+	}
+	SECTION("bulk") {
+		BENCHMARK("bulk noreuse, iters=" + std::to_string(iters)) {
+			lemire_algorithm_no_reuse<TestType> dist(0, same(right_bound));
+			return SumBulkGenerated<TestType>(dist, rng, iters);
+		};
+		BENCHMARK("bulk reuse, iters=" + std::to_string(iters)) {
+			lemire_algorithm_reuse<TestType> dist(0, same(right_bound));
+			return SumBulkGenerated<TestType>(dist, rng, iters);
+		};
+		BENCHMARK("bulk lazy-reuse, iters=" + std::to_string(iters)) {
+			lemire_algorithm_lazy_reuse<TestType> dist(0, same(right_bound));
+			return SumBulkGenerated<TestType>(dist, rng, iters);
+		};
+	}
 }
 
 // We could make all these into a single test case by putting the bounds
@@ -174,3 +1075,213 @@ TEMPLATE_TEST_CASE("integer for resampling", "[!benchmark]", uint32_t, uint64_t)
 	RunBenchmarksWithPremadeDistributions(TestType(100), iters);
 }
 
+
+template <typename TestType, typename Generator>
+static void RunBenchmarksWithGenerator(TestType right_bound, size_t iters) {
+	static_assert(std::is_unsigned<TestType>::value, "");
+	Generator rng;
+	const auto suffix = ", bound=" + std::to_string(right_bound) + ", iters=" + std::to_string(iters);
+	BENCHMARK("plain generator" + suffix) {
+		TestType sum = 0;
+		for (size_t n = 0; n < iters; ++n) {
+			sum += Catch::Detail::fillBitsFrom<TestType>(rng);
+		}
+		return sum;
+	};
+	BENCHMARK("noreuse" + suffix) {
+		TestType sum = 0;
+		lemire_algorithm_no_reuse<TestType> dist(0, same(right_bound));
+		for (size_t n = 0; n < iters; ++n) {
+			sum += dist(rng);
+		}
+		return sum;
+	};
+	BENCHMARK("reuse" + suffix) {
+		TestType sum = 0;
+		lemire_algorithm_reuse<TestType> dist(0, same(right_bound));
+		for (size_t n = 0; n < iters; ++n) {
+			sum += dist(rng);
+		}
+		return sum;
+	};
+}
+
+template <typename TestType, TestType Bound>
+static void BenchmarkFixedBound(size_t iters) {
+	SimplePcg32 rng;
+	const auto suffix = ", bound=" + std::to_string(Bound) + ", iters=" + std::to_string(iters);
+	BENCHMARK("runtime bound" + suffix) {
+		TestType sum = 0;
+		lemire_algorithm_reuse<TestType> dist(0, same(Bound));
+		for (size_t n = 0; n < iters; ++n) {
+			sum += dist(rng);
+		}
+		return sum;
+	};
+	BENCHMARK("fixed bound" + suffix) {
+		TestType sum = 0;
+		lemire_fixed<TestType, Bound> dist;
+		for (size_t n = 0; n < iters; ++n) {
+			sum += dist(rng);
+		}
+		return sum;
+	};
+}
+
+TEMPLATE_TEST_CASE("fixed bound bench", "[!benchmark]", uint32_t, uint64_t) {
+	size_t iters = GENERATE(100'000, 1'000'000, 10'000'000);
+	static constexpr TestType max = std::numeric_limits<TestType>::max();
+	BenchmarkFixedBound<TestType, 100>(iters);
+	// The distance is a power of two
+	BenchmarkFixedBound<TestType, 255>(iters);
+	BenchmarkFixedBound<TestType, 1'000'000>(iters);
+	BenchmarkFixedBound<TestType, max - 1>(iters);
+}
+
+TEST_CASE("shuffle bench", "[!benchmark]") {
+	auto size = GENERATE(as<size_t>{}, 100, 10'000, 1'000'000);
+	std::vector<uint32_t> values(size);
+	for (size_t i = 0; i < size; ++i) {
+		values[i] = static_cast<uint32_t>(i);
+	}
+
+	SimplePcg32 rng;
+	BENCHMARK("std::shuffle, size=" + std::to_string(size)) {
+		std::shuffle(values.begin(), values.end(), rng);
+		return values[0];
+	};
+	BENCHMARK("Fisher-Yates with noreuse, size=" + std::to_string(size)) {
+		for (size_t i = size - 1; i > 0; --i) {
+			lemire_algorithm_no_reuse<uint64_t> dist(0, i);
+			std::swap(values[i], values[dist(rng)]);
+		}
+		return values[0];
+	};
+	BENCHMARK("batched shuffle, size=" + std::to_string(size)) {
+		batched_shuffle(values.begin(), values.end(), rng);
+		return values[0];
+	};
+}
+
+TEMPLATE_TEST_CASE("uniform real bench", "[!benchmark]", float, double) {
+	size_t iters = GENERATE(100'000, 1'000'000, 10'000'000);
+	const auto bounds = GENERATE(table<TestType, TestType>({
+		{ TestType(0), TestType(1) },
+		{ TestType(-1), TestType(1) },
+		{ TestType(0.001), TestType(1000) } }));
+	const auto a = std::get<0>(bounds);
+	const auto b = std::get<1>(bounds);
+	const auto suffix = ", a=" + std::to_string(a) + ", b=" + std::to_string(b) + ", iters=" + std::to_string(iters);
+
+	SimplePcg32 rng;
+	BENCHMARK("std::uniform_real_distribution" + suffix) {
+		TestType sum = 0;
+		std::uniform_real_distribution<TestType> dist(a, b);
+		for (size_t n = 0; n < iters; ++n) {
+			sum += dist(rng);
+		}
+		return sum;
+	};
+	BENCHMARK("lemire uniform real" + suffix) {
+		TestType sum = 0;
+		lemire_uniform_real<TestType> dist(a, b);
+		for (size_t n = 0; n < iters; ++n) {
+			sum += dist(rng);
+		}
+		return sum;
+	};
+	BENCHMARK("bulk lemire uniform real" + suffix) {
+		lemire_uniform_real<TestType> dist(a, b);
+		return SumBulkGenerated<TestType>(dist, rng, iters);
+	};
+	MultiLanePcg32 multi_lane_rng;
+	BENCHMARK("bulk lemire uniform real with multi-lane generator" + suffix) {
+		lemire_uniform_real<TestType> dist(a, b);
+		return SumBulkGenerated<TestType>(dist, multi_lane_rng, iters);
+	};
+}
+
+TEST_CASE("32 bit bulk Lemire bench", "[!benchmark]") {
+	size_t iters = GENERATE(100'000, 1'000'000, 10'000'000);
+	auto bound = GENERATE(as<uint32_t>{}, 100, float_bound(uint32_t{}), std::numeric_limits<uint32_t>::max() - 1);
+	const auto suffix = ", bound=" + std::to_string(bound) + ", iters=" + std::to_string(iters);
+
+	SimplePcg32 rng;
+	BENCHMARK("reuse" + suffix) {
+		uint32_t sum = 0;
+		lemire_algorithm_reuse<uint32_t> dist(0, same(bound));
+		for (size_t n = 0; n < iters; ++n) {
+			sum += dist(rng);
+		}
+		return sum;
+	};
+	BENCHMARK("bulk reuse" + suffix) {
+		lemire_algorithm_reuse<uint32_t> dist(0, same(bound));
+		return SumBulkGenerated<uint32_t>(dist, rng, iters);
+	};
+	MultiLanePcg32 multi_lane_rng;
+	BENCHMARK("bulk reuse with multi-lane generator" + suffix) {
+		lemire_algorithm_reuse<uint32_t> dist(0, same(bound));
+		return SumBulkGenerated<uint32_t>(dist, multi_lane_rng, iters);
+	};
+
+	// Just the accept/reject step, on premade random numbers
+	static constexpr size_t chunk_size = 4096;
+	std::vector<uint32_t> bits(chunk_size), out(chunk_size);
+	for (auto& b : bits) {
+		b = rng();
+	}
+	const uint32_t distance = same(bound) + 1;
+	const uint32_t threshold = (~distance + 1) % distance;
+	BENCHMARK("scalar filter" + suffix) {
+		size_t accepted = 0;
+		for (size_t done = 0; done < iters; done += chunk_size) {
+			accepted += detail::lemireFilter32Scalar(bits.data(), chunk_size, 0, distance, threshold, out.data());
+		}
+		return accepted + out[0];
+	};
+#if defined( BULK_USE_AVX2_DISPATCH )
+	if (__builtin_cpu_supports("avx2")) {
+		BENCHMARK("AVX2 filter" + suffix) {
+			size_t accepted = 0;
+			for (size_t done = 0; done < iters; done += chunk_size) {
+				accepted += detail::lemireFilter32AVX2(bits.data(), chunk_size, 0, distance, threshold, out.data());
+			}
+			return accepted + out[0];
+		};
+	}
+#endif
+}
+
+#if defined( USE_UINT128 )
+TEMPLATE_TEST_CASE("generator bench", "[!benchmark]",
+	SimplePcg32,
+	std::mt19937_64,
+	SimplePcg64,
+	Lehmer128,
+	Xoshiro256PlusPlus,
+	Sfc64,
+	WyRand) {
+	size_t iters = GENERATE(100'000, 1'000'000, 10'000'000);
+	SECTION("uint32_t") {
+		auto bound = GENERATE(as<uint32_t>{}, 100, float_bound(uint32_t{}), std::numeric_limits<uint32_t>::max() - 1);
+		RunBenchmarksWithGenerator<uint32_t, TestType>(bound, iters);
+	}
+	SECTION("uint64_t") {
+		auto bound = GENERATE(as<uint64_t>{}, 100, float_bound(uint64_t{}), std::numeric_limits<uint64_t>::max() - 1);
+		RunBenchmarksWithGenerator<uint64_t, TestType>(bound, iters);
+	}
+}
+#endif
+
+// With plain 64 bit engine, the 32 bit distributions only use the top half of each output
+TEMPLATE_TEST_CASE("bit pool bench", "[!benchmark]", std::mt19937_64, Xoshiro256PlusPlus, Sfc64, WyRand) {
+	size_t iters = GENERATE(100'000, 1'000'000, 10'000'000);
+	auto bound = GENERATE(as<uint32_t>{}, 100, float_bound(uint32_t{}), std::numeric_limits<uint32_t>::max() - 1);
+	SECTION("direct") {
+		RunBenchmarksWithGenerator<uint32_t, TestType>(bound, iters);
+	}
+	SECTION("bit pool") {
+		RunBenchmarksWithGenerator<uint32_t, bit_pool<TestType>>(bound, iters);
+	}
+}
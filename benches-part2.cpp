@@ -4,12 +4,17 @@
 #include <catch2/internal/catch_random_integer_helpers.hpp>
 #include <catch2/generators/catch_generators.hpp>
 
+#include "checkpoint.hpp"
 #include "emul.hpp"
 #include "pcg.hpp"
 #include "distributions-lemire.hpp"
 #include "distributions-others.hpp"
+#include "engine-adapters.hpp"
+#include "generators.hpp"
 #include "inlining-blocker.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <random>
 
 TEST_CASE("Verify emul results") {
@@ -43,6 +48,34 @@ namespace {
             return ext_mul_intrinsic(a, b);
         }
     };
+    // For TEMPLATE_PRODUCT_TEST_CASE, which needs templates over just the integer type
+    template <typename IntegerType>
+    using lemire_plain_intrinsic = lemire_plain_templated_mult<IntrinsicMult, IntegerType>;
+    template <typename IntegerType>
+    using lemire_reuse_intrinsic = lemire_reuse_templated_mult<IntrinsicMult, IntegerType>;
+    // Hands out the numbers from the distribution's generate one at a time,
+    // so that bulk generation fits into the benchmarks that call operator().
+    template <typename Distribution, size_t N = 256>
+    class bulk_filled {
+    public:
+        using result_type = typename Distribution::result_type;
+
+        bulk_filled(result_type a, result_type b): m_dist(a, b) {}
+
+        template <typename Generator>
+        result_type operator()(Generator& g) {
+            if (m_pos == N) {
+                m_dist.generate(m_buffer, m_buffer + N, g);
+                m_pos = 0;
+            }
+            return m_buffer[m_pos++];
+        }
+
+    private:
+        Distribution m_dist;
+        result_type m_buffer[N];
+        size_t m_pos = N;
+    };
     static std::vector<uint64_t> generate_random_data(size_t size) {
         std::vector<uint64_t> data; data.reserve(size);
         std::random_device rd;
@@ -99,20 +132,173 @@ TEMPLATE_TEST_CASE("Emul benchmarks", "[!benchmark]", NaiveMult, OptimizedMult,
     };
 }
 
+#if defined( USE_UINT128 )
+TEST_CASE("Verify 128 bit emul results") {
+    std::random_device rd;
+    auto draw = [&] {
+        auto upper = Catch::Detail::fillBitsFrom<uint64_t>(rd);
+        auto lower = Catch::Detail::fillBitsFrom<uint64_t>(rd);
+        return (__uint128_t(upper) << 64) | lower;
+    };
+    auto check = [](__uint128_t num1, __uint128_t num2) {
+        auto result_naive = ext_mul128_naive(num1, num2);
+        auto result_optimized = ext_mul128_optimized(num1, num2);
+        auto result_intrinsic = ext_mul128_intrinsic(num1, num2);
+        REQUIRE(result_naive == result_optimized);
+        REQUIRE(result_optimized == result_intrinsic);
+        REQUIRE(result_naive.lower == num1 * num2);
+    };
+    const auto max = ~__uint128_t(0);
+    check(max, max);
+    REQUIRE(ext_mul128_naive(max, max).upper == max - 1);
+    REQUIRE(ext_mul128_naive(max, max).lower == 1);
+    for (int i = 0; i < 1'000'000; ++i) {
+        check(draw(), draw());
+    }
+}
+
+namespace {
+    struct NaiveMult128 {
+        static ext_mul128_result Mult(__uint128_t a, __uint128_t b) {
+            return ext_mul128_naive(a, b);
+        }
+    };
+    struct OptimizedMult128 {
+        static ext_mul128_result Mult(__uint128_t a, __uint128_t b) {
+            return ext_mul128_optimized(a, b);
+        }
+    };
+    struct IntrinsicMult128 {
+        static ext_mul128_result Mult(__uint128_t a, __uint128_t b) {
+            return ext_mul128_intrinsic(a, b);
+        }
+    };
+}
+
+TEMPLATE_TEST_CASE("128 bit emul benchmarks", "[!benchmark]", NaiveMult128, OptimizedMult128, IntrinsicMult128) {
+    auto size = GENERATE(as<size_t>{}, 10'000, 100'000, 1'000'000);
+    BENCHMARK_ADVANCED("iters=" + std::to_string(size))(Catch::Benchmark::Chronometer meter) {
+        auto data1 = generate_random_data(2 * size);
+        auto data2 = generate_random_data(2 * size);
+        meter.measure([&](int) {
+            __uint128_t sum = 0;
+            for (size_t sz = 0; sz < size; ++sz) {
+                auto [high, low] = TestType::Mult((__uint128_t(data1[2 * sz]) << 64) | data1[2 * sz + 1],
+                                                  (__uint128_t(data2[2 * sz]) << 64) | data2[2 * sz + 1]);
+                sum += high;
+                sum += low;
+            }
+            return static_cast<uint64_t>(sum ^ (sum >> 64));
+        });
+    };
+}
+
+TEMPLATE_TEST_CASE("128 bit distribution tests", "[distributions]",
+    lemire_uint128_templated_mult<NaiveMult128>,
+    lemire_uint128_templated_mult<OptimizedMult128>,
+    lemire_uint128_templated_mult<IntrinsicMult128>) {
+    const size_t tests = 10'000;
+    SimplePcg32 pcg(std::random_device{}());
+    auto check_bounds = [&](__uint128_t low, __uint128_t high) {
+        TestType dist(low, high);
+        for (size_t t = 0; t < tests; ++t) {
+            auto result = dist(pcg);
+            REQUIRE(result >= low);
+            REQUIRE(result <= high);
+        }
+    };
+    SECTION("Some bounds") {
+        check_bounds(7, 22);
+    }
+    SECTION("Bounds past 64 bits") {
+        check_bounds(__uint128_t(1) << 100, (__uint128_t(1) << 127) + 5);
+        check_bounds(0, ~__uint128_t(0) - 1);
+    }
+    SECTION("Unitary bound") {
+        const auto low = (__uint128_t(42) << 64) + 42;
+        check_bounds(low, low);
+    }
+    SECTION("Restored distribution continues bit-identically") {
+        TestType dist(3, (__uint128_t(1) << 127) + 1);
+        for (size_t i = 0; i < 1'000; ++i) {
+            dist(pcg);
+        }
+        checkpoint_writer writer;
+        dist.save(writer);
+        SimplePcg32 pcg_copy = pcg;
+
+        TestType restored_dist(0, 0);
+        checkpoint_reader reader(writer.bytes());
+        restored_dist.restore(reader);
+        REQUIRE(reader.remaining() == 0);
+        for (size_t i = 0; i < 1'000; ++i) {
+            REQUIRE(restored_dist(pcg_copy) == dist(pcg));
+        }
+    }
+}
+
+TEST_CASE("128 bit Lemire gives the same results with all multiplications", "[distributions]") {
+    const auto rand_seed = std::random_device{}();
+    CAPTURE(rand_seed);
+    for (auto high : { __uint128_t(1567894), (__uint128_t(1) << 127) + 1, ~__uint128_t(0) / 3 * 2 }) {
+        lemire_uint128_templated_mult<NaiveMult128> d1(7, high);
+        lemire_uint128_templated_mult<OptimizedMult128> d2(7, high);
+        lemire_uint128_templated_mult<IntrinsicMult128> d3(7, high);
+        SimplePcg32 pcg1(rand_seed), pcg2(rand_seed), pcg3(rand_seed);
+        for (size_t i = 0; i < 100'000; ++i) {
+            const auto expected = d1(pcg1);
+            REQUIRE(d2(pcg2) == expected);
+            REQUIRE(d3(pcg3) == expected);
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE("Benchmark 128 bit Lemire", "[!benchmark]",
+    lemire_uint128_templated_mult<NaiveMult128>,
+    lemire_uint128_templated_mult<OptimizedMult128>,
+    lemire_uint128_templated_mult<IntrinsicMult128>) {
+    // Bound, and its name for the benchmark
+    auto bounds = GENERATE(as<std::pair<__uint128_t, std::string>>{},
+        std::make_pair(__uint128_t(100), "100"),
+        std::make_pair(__uint128_t(1) << 64, "2^64"),
+        std::make_pair(__uint128_t(1) << 96, "2^96"),
+        std::make_pair(__uint128_t(1) << 127, "2^127"),
+        std::make_pair(~__uint128_t(0) / 3 * 2, "(2^128 - 1) * 2/3"),
+        std::make_pair(~__uint128_t(0) - 1, "2^128 - 2"));
+    auto iters = GENERATE(as<size_t>{}, 100'000, 1'000'000);
+
+    SimplePcg64 rng;
+    BENCHMARK("bounds=" + bounds.second + ", iters=" + std::to_string(iters)) {
+        __uint128_t sum = 0;
+        TestType dist(0, bounds.first + same(uint64_t(0)));
+        for (size_t n = 0; n < iters; ++n) {
+            sum += dist(rng);
+        }
+        return static_cast<uint64_t>(sum ^ (sum >> 64));
+    };
+}
+#endif
 
 TEMPLATE_TEST_CASE("Distribution tests", "[distributions]",
-    OpenBSD_plain,
-    OpenBSD_reuse,
-    OpenBSD_libdivide,
-    java_plain,
-    java_reuse,
-    java_libdivide,
+    OpenBSD_plain<uint64_t>,
+    OpenBSD_reuse<uint64_t>,
+    OpenBSD_libdivide<uint64_t>,
+    java_plain<uint64_t>,
+    java_reuse<uint64_t>,
+    java_libdivide<uint64_t>,
+    bitmask_plain,
+    bitmask_reuse,
     lemire_plain_templated_mult<NaiveMult>,
     lemire_plain_templated_mult<OptimizedMult>,
     lemire_plain_templated_mult<IntrinsicMult>,
     lemire_reuse_templated_mult<NaiveMult>,
     lemire_reuse_templated_mult<OptimizedMult>,
-    lemire_reuse_templated_mult<IntrinsicMult>) {
+    lemire_reuse_templated_mult<IntrinsicMult>,
+    lemire_canon_templated_mult<NaiveMult>,
+    lemire_canon_templated_mult<OptimizedMult>,
+    lemire_canon_templated_mult<IntrinsicMult>,
+    lemire_batched<uint64_t>,
+    lemire_adaptive<>) {
     const size_t tests = 10'000;
     SimplePcg32 pcg(std::random_device{}());
     SECTION("Some bounds") {
@@ -125,6 +311,19 @@ TEMPLATE_TEST_CASE("Distribution tests", "[distributions]",
             REQUIRE(result <= high);
         }
     }
+#if defined( PCG_USE_UINT128 )
+    SECTION("Some bounds, 64 bit generator") {
+        SimplePcg64 pcg64(std::random_device{}());
+        uint64_t low = 7;
+        uint64_t high = 22;
+        TestType dist(low, high);
+        for (size_t t = 0; t < tests; ++t) {
+            auto result = dist(pcg64);
+            REQUIRE(result >= low);
+            REQUIRE(result <= high);
+        }
+    }
+#endif
     SECTION("Unitary bound") {
         uint64_t low = 42;
         uint64_t high = low;
@@ -135,22 +334,409 @@ TEMPLATE_TEST_CASE("Distribution tests", "[distributions]",
             REQUIRE(result <= high);
         }
     }
+    SECTION("Bulk generation") {
+        uint64_t low = 7;
+        uint64_t high = 22;
+        TestType dist(low, high);
+        std::vector<uint64_t> results(tests);
+        dist.generate(results.begin(), results.end(), pcg);
+        for (auto result : results) {
+            REQUIRE(result >= low);
+            REQUIRE(result <= high);
+        }
+    }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("Distribution tests for other integer types", "[distributions]",
+    (java_plain, java_reuse, java_libdivide,
+     OpenBSD_plain, OpenBSD_reuse, OpenBSD_libdivide,
+     lemire_plain_intrinsic, lemire_reuse_intrinsic),
+    (int8_t, uint8_t, int16_t, uint16_t, int32_t, uint32_t, int64_t)) {
+    using IntegerType = typename TestType::result_type;
+    using limits = std::numeric_limits<IntegerType>;
+    SimplePcg32 pcg(std::random_device{}());
+    auto check_bounds = [&](IntegerType low, IntegerType high) {
+        TestType dist(low, high);
+        for (size_t t = 0; t < 10'000; ++t) {
+            auto result = dist(pcg);
+            REQUIRE(result >= low);
+            REQUIRE(result <= high);
+        }
+        std::vector<IntegerType> results(1'000);
+        dist.generate(results.begin(), results.end(), pcg);
+        for (auto result : results) {
+            REQUIRE(result >= low);
+            REQUIRE(result <= high);
+        }
+    };
+    const IntegerType lowest_small = std::is_signed<IntegerType>::value ? -20 : 0;
+    SECTION("Some bounds") {
+        check_bounds(7, 22);
+        check_bounds(lowest_small, 17);
+    }
+    SECTION("Full range") {
+        check_bounds(limits::min(), limits::max());
+        check_bounds(limits::min(), limits::max() - 1);
+        check_bounds(limits::min() + 1, limits::max());
+    }
+    SECTION("Unitary bound") {
+        check_bounds(42, 42);
+    }
+    SECTION("No bias towards the low numbers") {
+        // For 8 bit types, 2^8 % 100 of the numbers are twice as likely
+        // if the rejection threshold is wrong.
+        const IntegerType low = lowest_small;
+        TestType dist(low, static_cast<IntegerType>(low + 99));
+        std::vector<size_t> counts(100);
+        for (size_t t = 0; t < 200'000; ++t) {
+            ++counts[static_cast<size_t>(dist(pcg) - low)];
+        }
+        for (auto count : counts) {
+            // The mean is 2000 and the standard deviation about 44
+            REQUIRE(count > 1'700);
+            REQUIRE(count < 2'300);
+        }
+    }
+}
+
+template <typename Distribution, typename Generator>
+static void RunBenchmarksWithOtherDistributions() {
+    auto bounds = GENERATE(as<uint64_t>{},
+        100,
+        std::numeric_limits<uint32_t>::max() - 1,
+        std::numeric_limits<uint32_t>::max(),
+        uint64_t(std::numeric_limits<uint32_t>::max()) + 1,
+        uint64_t(1) << 36,
+        uint64_t(1) << 40,
+        uint64_t(1) << 44,
+        uint64_t(1) << 48,
+        uint64_t(1) << 52,
+        uint64_t(1) << 56,
+        uint64_t(1) << 60,
+        std::numeric_limits<uint64_t>::max() / 2 + 1,
+        12298110947468241578,
+        std::numeric_limits<uint64_t>::max() - 1);
+    auto iters = GENERATE(as<size_t>{}, 100'000, 1'000'000, 10'000'000);
+
+    Generator rng;
+    BENCHMARK("bounds=" + std::to_string(bounds) + ", iters=" + std::to_string(iters)) {
+        uint64_t sum = 0;
+        Distribution dist(0, same(bounds));
+        for (size_t n = 0; n < iters; ++n) {
+            sum += dist(rng);
+        }
+        return sum;
+    };
 }
 
 TEMPLATE_TEST_CASE("Benchmark with other distributions", "[!benchmark]",
-    OpenBSD_plain,
-    java_plain,
-    OpenBSD_reuse,
-    java_reuse,
-    OpenBSD_libdivide,
-    java_libdivide,
+    OpenBSD_plain<uint64_t>,
+    java_plain<uint64_t>,
+    OpenBSD_reuse<uint64_t>,
+    java_reuse<uint64_t>,
+    OpenBSD_libdivide<uint64_t>,
+    java_libdivide<uint64_t>,
+    bulk_filled<OpenBSD_libdivide<uint64_t>>,
+    bulk_filled<java_libdivide<uint64_t>>,
+    bitmask_plain,
+    bitmask_reuse,
+    lemire_reuse_templated_mult<NaiveMult>,
+    lemire_reuse_templated_mult<OptimizedMult>,
+    lemire_reuse_templated_mult<IntrinsicMult>,
+    lemire_plain_templated_mult<NaiveMult>,
+    lemire_plain_templated_mult<OptimizedMult>,
+    lemire_plain_templated_mult<IntrinsicMult>,
+    lemire_canon_templated_mult<NaiveMult>,
+    lemire_canon_templated_mult<OptimizedMult>,
+    lemire_canon_templated_mult<IntrinsicMult>,
+    lemire_batched<uint64_t>,
+    lemire_adaptive<>) {
+    RunBenchmarksWithOtherDistributions<TestType, SimplePcg32>();
+}
+
+#if defined( PCG_USE_UINT128 )
+// With a 64 bit generator, every number costs just one call to the generator
+TEMPLATE_TEST_CASE("Benchmark with other distributions and 64 bit generator", "[!benchmark]",
+    OpenBSD_plain<uint64_t>,
+    java_plain<uint64_t>,
+    OpenBSD_reuse<uint64_t>,
+    java_reuse<uint64_t>,
+    OpenBSD_libdivide<uint64_t>,
+    java_libdivide<uint64_t>,
+    bulk_filled<OpenBSD_libdivide<uint64_t>>,
+    bulk_filled<java_libdivide<uint64_t>>,
+    bitmask_plain,
+    bitmask_reuse,
     lemire_reuse_templated_mult<NaiveMult>,
     lemire_reuse_templated_mult<OptimizedMult>,
     lemire_reuse_templated_mult<IntrinsicMult>,
     lemire_plain_templated_mult<NaiveMult>,
     lemire_plain_templated_mult<OptimizedMult>,
+    lemire_plain_templated_mult<IntrinsicMult>,
+    lemire_canon_templated_mult<NaiveMult>,
+    lemire_canon_templated_mult<OptimizedMult>,
+    lemire_canon_templated_mult<IntrinsicMult>,
+    lemire_batched<uint64_t>,
+    lemire_adaptive<>) {
+    RunBenchmarksWithOtherDistributions<TestType, SimplePcg64>();
+}
+#endif
+
+// lemire_adaptive should be as fast as the fixed variant it picks for each
+// bound, as all it adds is a predictable branch on its kernel once the batch
+// is empty. The bounds are one for each of its kernels: two batch sizes, a
+// power of two, Lemire's method and the rejection-free one twice.
+TEST_CASE("Benchmark adaptive against the fixed variants", "[!benchmark]") {
+    auto bounds = GENERATE(as<uint64_t>{},
+        16,
+        1'567'893,
+        (uint64_t(1) << 40) - 1,
+        (uint64_t(1) << 40) + 5,
+        12298110947468241577ULL,
+        uint64_t(1) << 63);
+    static constexpr size_t iters = 1'000'000;
+
+    SimplePcg32 rng;
+    const auto run = [&](auto dist) {
+        uint64_t sum = 0;
+        for (size_t n = 0; n < iters; ++n) {
+            sum += dist(rng);
+        }
+        return sum;
+    };
+    const auto suffix = ", bounds=" + std::to_string(bounds);
+    BENCHMARK("lemire_adaptive" + suffix) {
+        return run(lemire_adaptive<>(0, same(bounds)));
+    };
+    BENCHMARK("lemire_batched" + suffix) {
+        return run(lemire_batched<uint64_t>(0, same(bounds)));
+    };
+    BENCHMARK("lemire_reuse" + suffix) {
+        return run(lemire_reuse_templated_mult<IntrinsicMult>(0, same(bounds)));
+    };
+    BENCHMARK("lemire_canon" + suffix) {
+        return run(lemire_canon_templated_mult<IntrinsicMult>(0, same(bounds)));
+    };
+}
+
+template <typename Distribution>
+static void RunBenchmarksWithIntegerTypes() {
+    using IntegerType = typename Distribution::result_type;
+    using limits = std::numeric_limits<IntegerType>;
+    // The same kinds of bounds as RunBenchmarksWithOtherDistributions,
+    // scaled down to the type
+    auto bounds = GENERATE(as<uint64_t>{},
+        100,
+        uint64_t(limits::max()) / 2 + 1,
+        uint64_t(limits::max()) / 3 * 2,
+        uint64_t(limits::max()) - 1);
+    auto iters = GENERATE(as<size_t>{}, 100'000, 1'000'000, 10'000'000);
+
+    SimplePcg32 rng;
+    BENCHMARK("bounds=" + std::to_string(bounds) + ", iters=" + std::to_string(iters)) {
+        uint64_t sum = 0;
+        Distribution dist(0, static_cast<IntegerType>(same(bounds)));
+        for (size_t n = 0; n < iters; ++n) {
+            sum += dist(rng);
+        }
+        return sum;
+    };
+}
+
+// Narrower types need one 32 bit number per call, and divide or multiply
+// at their own width, so they should be faster than the same bounds in
+// 64 bit distributions.
+TEMPLATE_PRODUCT_TEST_CASE("Benchmark distributions with integer types", "[!benchmark]",
+    (java_reuse, java_libdivide, OpenBSD_reuse, OpenBSD_libdivide, lemire_reuse_intrinsic),
+    (uint8_t, uint16_t, uint32_t, uint64_t)) {
+    RunBenchmarksWithIntegerTypes<TestType>();
+}
+
+#if defined( USE_UINT128 )
+// Only the reuse variants, as those are what a hot path would use
+TEMPLATE_TEST_CASE("Benchmark generators with other distributions", "[!benchmark]",
+    SimplePcg32,
+    std::mt19937_64,
+    SimplePcg64,
+    Lehmer128,
+    Xoshiro256PlusPlus,
+    Sfc64,
+    WyRand) {
+    SECTION("OpenBSD_reuse") {
+        RunBenchmarksWithOtherDistributions<OpenBSD_reuse<uint64_t>, TestType>();
+    }
+    SECTION("java_reuse") {
+        RunBenchmarksWithOtherDistributions<java_reuse<uint64_t>, TestType>();
+    }
+    SECTION("lemire_reuse_templated_mult<IntrinsicMult>") {
+        RunBenchmarksWithOtherDistributions<lemire_reuse_templated_mult<IntrinsicMult>, TestType>();
+    }
+}
+#endif
+
+#if defined( BULK_USE_AVX2_DISPATCH )
+TEST_CASE("AVX2 and scalar branchfree remainders agree", "[reproducibility]") {
+    if (__builtin_cpu_supports("avx2")) {
+        // Not a multiple of 8, so that the scalar tail gets used too
+        static constexpr size_t count = 1'003;
+        SimplePcg32 rng(std::random_device{}());
+        SECTION("32 bit") {
+            auto divisor = GENERATE(as<uint32_t>{}, 2, 3, 7, 64, 100, 1'000'000, 2'147'483'649u, 4'294'967'295u);
+            CAPTURE(divisor);
+            const auto branchfree = libdivide::libdivide_u32_branchfree_gen(divisor);
+            std::vector<uint32_t> in(count), scalar(count), avx2(count);
+            for (auto& x : in) {
+                x = rng();
+            }
+            detail::remaindersBranchfree32Scalar(in.data(), count, branchfree.magic, branchfree.more, divisor, scalar.data());
+            detail::remaindersBranchfree32AVX2(in.data(), count, branchfree.magic, branchfree.more, divisor, avx2.data());
+            for (size_t i = 0; i < count; ++i) {
+                REQUIRE(scalar[i] == in[i] % divisor);
+                REQUIRE(avx2[i] == in[i] % divisor);
+            }
+        }
+        SECTION("64 bit") {
+            auto divisor = GENERATE(as<uint64_t>{}, 2, 3, 7, 100, uint64_t(1) << 40, (uint64_t(1) << 40) + 1,
+                12298110947468241578ULL, std::numeric_limits<uint64_t>::max());
+            CAPTURE(divisor);
+            const auto branchfree = libdivide::libdivide_u64_branchfree_gen(divisor);
+            std::vector<uint64_t> in(count), scalar(count), avx2(count);
+            for (auto& x : in) {
+                x = Catch::Detail::fillBitsFrom<uint64_t>(rng);
+            }
+            detail::remaindersBranchfree64Scalar(in.data(), count, branchfree.magic, branchfree.more, divisor, scalar.data());
+            detail::remaindersBranchfree64AVX2(in.data(), count, branchfree.magic, branchfree.more, divisor, avx2.data());
+            for (size_t i = 0; i < count; ++i) {
+                REQUIRE(scalar[i] == in[i] % divisor);
+                REQUIRE(avx2[i] == in[i] % divisor);
+            }
+        }
+    }
+}
+#endif
+
+template <typename Dist1, typename Dist2, typename Generator = SimplePcg32>
+void CheckEqualBulkResultsForDists(typename Dist1::result_type a, typename Dist1::result_type b) {
+    Dist1 d1(a, b);
+    Dist2 d2(a, b);
+    const auto rand_seed = std::random_device{}();
+    CAPTURE(rand_seed);
+    Generator pcg1(rand_seed), pcg2(rand_seed);
+    // Not a multiple of the chunk size, nor of the vector width
+    std::vector<typename Dist1::result_type> out1(10'003), out2(10'003);
+    d1.generate(out1.begin(), out1.end(), pcg1);
+    d2.generate(out2.begin(), out2.end(), pcg2);
+    REQUIRE(out1 == out2);
+    REQUIRE(pcg1() == pcg2());
+}
+
+// The libdivide variants compute the remainders a chunk at a time, but
+// must still redraw the rejected numbers the same way as the plain ones
+TEMPLATE_TEST_CASE("Bulk libdivide distributions return the same numbers as the plain ones", "[distributions]",
+    uint32_t, int32_t, uint64_t, int64_t, long long, unsigned long long) {
+    using limits = std::numeric_limits<TestType>;
+    const TestType low = std::is_signed<TestType>::value ? -20 : 3;
+    // Rejects about a third of the draws
+    const auto often_rejected = static_cast<TestType>(limits::min() + (limits::max() / 3 * 2));
+    // A distance of 2^N / 3 + 1, which rejects a third of the draws too
+    const auto third_rejected = static_cast<TestType>(limits::min() + std::make_unsigned_t<TestType>(-1) / 3);
+
+    CheckEqualBulkResultsForDists<java_plain<TestType>, java_libdivide<TestType>>(low, static_cast<TestType>(low + 97));
+    CheckEqualBulkResultsForDists<java_plain<TestType>, java_libdivide<TestType>>(limits::min(), often_rejected);
+    CheckEqualBulkResultsForDists<java_plain<TestType>, java_libdivide<TestType>>(limits::min(), third_rejected);
+    CheckEqualBulkResultsForDists<java_plain<TestType>, java_libdivide<TestType>>(low, low);
+    CheckEqualBulkResultsForDists<java_plain<TestType>, java_libdivide<TestType>>(limits::min(), limits::max());
+
+    CheckEqualBulkResultsForDists<OpenBSD_plain<TestType>, OpenBSD_libdivide<TestType>>(low, static_cast<TestType>(low + 97));
+    CheckEqualBulkResultsForDists<OpenBSD_plain<TestType>, OpenBSD_libdivide<TestType>>(limits::min(), often_rejected);
+    CheckEqualBulkResultsForDists<OpenBSD_plain<TestType>, OpenBSD_libdivide<TestType>>(limits::min(), third_rejected);
+    CheckEqualBulkResultsForDists<OpenBSD_plain<TestType>, OpenBSD_libdivide<TestType>>(low, low);
+    CheckEqualBulkResultsForDists<OpenBSD_plain<TestType>, OpenBSD_libdivide<TestType>>(limits::min(), limits::max());
+
+    // Engines with bulk fill take the bulk path even when rejections are rare
+    CheckEqualBulkResultsForDists<java_plain<TestType>, java_libdivide<TestType>, MultiLanePcg32>(
+        low, static_cast<TestType>(low + 97));
+    CheckEqualBulkResultsForDists<OpenBSD_plain<TestType>, OpenBSD_libdivide<TestType>, MultiLanePcg32>(
+        low, static_cast<TestType>(low + 97));
+}
+
+TEST_CASE("Buffered engine returns the same numbers as the engine", "[reproducibility]") {
+    const auto seed = std::random_device{}();
+    CAPTURE(seed);
+    SECTION("Using PCG") {
+        SimplePcg32 pcg(seed);
+        buffered_engine<SimplePcg32, 64> buffered(SimplePcg32{seed});
+        for (size_t i = 0; i < 10'000; ++i) {
+            REQUIRE(pcg() == buffered());
+        }
+    }
+    SECTION("Using multi-lane PCG, with bulk fill") {
+        MultiLanePcg32 pcg(seed);
+        buffered_engine<MultiLanePcg32, 100> buffered(MultiLanePcg32{seed});
+        for (size_t i = 0; i < 10'000; ++i) {
+            REQUIRE(pcg() == buffered());
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE("Benchmark buffered engine", "[!benchmark]",
+    lemire_algorithm_reuse<uint64_t>,
+    OpenBSD_reuse<uint64_t>) {
+    SECTION("unbuffered") {
+        RunBenchmarksWithOtherDistributions<TestType, SimplePcg32>();
+    }
+    SECTION("N=64") {
+        RunBenchmarksWithOtherDistributions<TestType, buffered_engine<SimplePcg32, 64>>();
+    }
+    SECTION("N=256") {
+        RunBenchmarksWithOtherDistributions<TestType, buffered_engine<SimplePcg32, 256>>();
+    }
+    SECTION("N=1024") {
+        RunBenchmarksWithOtherDistributions<TestType, buffered_engine<SimplePcg32, 1024>>();
+    }
+}
+
+TEMPLATE_TEST_CASE("Benchmark bulk generation with other distributions", "[!benchmark]",
+    OpenBSD_reuse<uint64_t>,
+    java_reuse<uint64_t>,
+    bitmask_reuse,
+    OpenBSD_libdivide<uint64_t>,
+    java_libdivide<uint64_t>,
+    lemire_reuse_templated_mult<IntrinsicMult>,
     lemire_plain_templated_mult<IntrinsicMult>) {
+    auto bounds = GENERATE(as<uint64_t>{},
+        100,
+        std::numeric_limits<uint32_t>::max() - 1,
+        std::numeric_limits<uint64_t>::max() / 2 + 1,
+        12298110947468241578);
+    size_t iters = GENERATE(100'000, 1'000'000, 10'000'000);
+
+    SimplePcg32 rng;
+    BENCHMARK("one at a time, bounds=" + std::to_string(bounds) + ", iters=" + std::to_string(iters)) {
+        uint64_t sum = 0;
+        TestType dist(0, same(bounds));
+        for (size_t n = 0; n < iters; ++n) {
+            sum += dist(rng);
+        }
+        return sum;
+    };
+    BENCHMARK("bulk, bounds=" + std::to_string(bounds) + ", iters=" + std::to_string(iters)) {
+        static constexpr size_t chunk_size = 4096;
+        uint64_t chunk[chunk_size];
+        uint64_t sum = 0;
+        TestType dist(0, same(bounds));
+        for (size_t done = 0; done < iters; done += chunk_size) {
+            const size_t now = std::min(iters - done, chunk_size);
+            dist.generate(chunk, chunk + now, rng);
+            for (size_t i = 0; i < now; ++i) {
+                sum += chunk[i];
+            }
+        }
+        return sum;
+    };
+}
 
+TEST_CASE("Benchmark 64 bit bulk Lemire", "[!benchmark]") {
     auto bounds = GENERATE(as<uint64_t>{},
         100,
         std::numeric_limits<uint32_t>::max() - 1,
@@ -166,25 +752,179 @@ TEMPLATE_TEST_CASE("Benchmark with other distributions", "[!benchmark]",
         std::numeric_limits<uint64_t>::max() / 2 + 1,
         12298110947468241578,
         std::numeric_limits<uint64_t>::max() - 1);
-    auto iters = GENERATE(as<size_t>{}, 100'000, 1'000'000, 10'000'000);
+    size_t iters = GENERATE(100'000, 1'000'000, 10'000'000);
+    const auto suffix = ", bounds=" + std::to_string(bounds) + ", iters=" + std::to_string(iters);
+
+    static constexpr size_t chunk_size = 4096;
+    auto sum_bulk = [&](auto& rng) {
+        uint64_t chunk[chunk_size];
+        uint64_t sum = 0;
+        lemire_algorithm_reuse<uint64_t> dist(0, same(bounds));
+        for (size_t done = 0; done < iters; done += chunk_size) {
+            const size_t now = std::min(iters - done, chunk_size);
+            dist.generate(chunk, chunk + now, rng);
+            for (size_t i = 0; i < now; ++i) {
+                sum += chunk[i];
+            }
+        }
+        return sum;
+    };
 
     SimplePcg32 rng;
-    BENCHMARK("bounds=" + std::to_string(bounds) + ", iters=" + std::to_string(iters)) {
+    BENCHMARK("lemire_reuse_templated_mult<IntrinsicMult>" + suffix) {
         uint64_t sum = 0;
-        TestType dist(0, same(bounds));
+        lemire_reuse_templated_mult<IntrinsicMult> dist(0, same(bounds));
         for (size_t n = 0; n < iters; ++n) {
             sum += dist(rng);
         }
         return sum;
     };
+    BENCHMARK("bulk" + suffix) {
+        return sum_bulk(rng);
+    };
+    MultiLanePcg32 multi_lane_rng;
+    BENCHMARK("bulk with multi-lane generator" + suffix) {
+        return sum_bulk(multi_lane_rng);
+    };
+
+    // Just the accept/reject step, on premade random numbers
+    auto bits = generate_random_data(chunk_size);
+    std::vector<uint64_t> out(chunk_size);
+    const uint64_t distance = same(bounds) + 1;
+    const uint64_t threshold = (~distance + 1) % distance;
+    BENCHMARK("scalar filter" + suffix) {
+        size_t accepted = 0;
+        for (size_t done = 0; done < iters; done += chunk_size) {
+            accepted += detail::lemireFilter64Scalar(bits.data(), chunk_size, 0, distance, threshold, out.data());
+        }
+        return accepted + out[0];
+    };
+#if defined( BULK_USE_AVX2_DISPATCH )
+    if (__builtin_cpu_supports("avx512f")) {
+        BENCHMARK("AVX-512 filter" + suffix) {
+            size_t accepted = 0;
+            for (size_t done = 0; done < iters; done += chunk_size) {
+                accepted += detail::lemireFilter64AVX512(bits.data(), chunk_size, 0, distance, threshold, out.data());
+            }
+            return accepted + out[0];
+        };
+    }
+#endif
+}
+
+TEST_CASE("Canon's variant calls the generator at most twice", "[distributions]") {
+    struct CountingMt {
+        using result_type = uint64_t;
+        static constexpr result_type (min)() { return 0; }
+        static constexpr result_type (max)() { return static_cast<result_type>(-1); }
+        std::mt19937_64 mt;
+        size_t calls = 0;
+        result_type operator()() {
+            ++calls;
+            return mt();
+        }
+    };
+    CountingMt rng{ std::mt19937_64(std::random_device{}()) };
+
+    // The second number is needed when the lower half of the product is
+    // above 2^64 - distance, so for two thirds of the numbers here.
+    const uint64_t high = 12298110947468241577ULL;
+    lemire_canon_templated_mult<IntrinsicMult> dist(0, high);
+    size_t two_calls = 0;
+    for (size_t i = 0; i < 100'000; ++i) {
+        const auto calls_before = rng.calls;
+        REQUIRE(dist(rng) <= high);
+        const auto calls = rng.calls - calls_before;
+        REQUIRE(calls <= 2);
+        two_calls += calls == 2;
+    }
+    REQUIRE(two_calls > 64'000);
+    REQUIRE(two_calls < 69'000);
+}
+
+// Every bound depends on the previous result, so this measures how long
+// a single call takes, including the rare slow paths, rather than how
+// many calls can be in flight at once.
+TEMPLATE_TEST_CASE("Benchmark latency of dependent calls", "[!benchmark]",
+    lemire_plain_templated_mult<IntrinsicMult>,
+    lemire_reuse_templated_mult<IntrinsicMult>,
+    lemire_canon_templated_mult<IntrinsicMult>,
+    lemire_algorithm_no_reuse<uint64_t>) {
+    auto bounds = GENERATE(as<uint64_t>{},
+        100,
+        std::numeric_limits<uint32_t>::max() - 1,
+        std::numeric_limits<uint64_t>::max() / 2 + 1,
+        12298110947468241578);
+    size_t iters = GENERATE(100'000, 1'000'000);
+
+    SimplePcg32 rng;
+    BENCHMARK("bounds=" + std::to_string(bounds) + ", iters=" + std::to_string(iters)) {
+        uint64_t last = 0;
+        for (size_t n = 0; n < iters; ++n) {
+            TestType dist(0, same(bounds) - (last & 1));
+            last = dist(rng);
+        }
+        return last;
+    };
+}
+
+// The mean above hides the rare slow paths: rejections, computing the
+// threshold and Canon's second draw. This times small groups of dependent
+// calls instead, so that one slow call dominates its group, while the
+// clock's own overhead is spread over the whole group. Passing the result
+// through same() keeps the calls between the two clock reads.
+TEMPLATE_TEST_CASE("Benchmark tail latency of dependent calls", "[!benchmark]",
+    lemire_plain_templated_mult<IntrinsicMult>,
+    lemire_reuse_templated_mult<IntrinsicMult>,
+    lemire_canon_templated_mult<IntrinsicMult>,
+    lemire_algorithm_no_reuse<uint64_t>) {
+    auto bounds = GENERATE(as<uint64_t>{},
+        100,
+        std::numeric_limits<uint32_t>::max() - 1,
+        std::numeric_limits<uint64_t>::max() / 2 + 1,
+        12298110947468241578);
+    static constexpr size_t group_size = 8;
+    static constexpr size_t groups = 200'000;
+
+    SimplePcg32 rng;
+    std::vector<double> nanos_per_call(groups);
+    uint64_t last = 0;
+    for (auto& nanos : nanos_per_call) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < group_size; ++n) {
+            TestType dist(0, same(bounds) - (last & 1));
+            last = dist(rng);
+        }
+        last = same(last);
+        const auto stop = std::chrono::steady_clock::now();
+        nanos = std::chrono::duration<double, std::nano>(stop - start).count() / group_size;
+    }
+    std::sort(nanos_per_call.begin(), nanos_per_call.end());
+    auto percentile = [&](double p) {
+        return std::to_string(nanos_per_call[static_cast<size_t>(p * (groups - 1))]);
+    };
+    WARN("bounds=" + std::to_string(bounds) + ", ns per call in groups of " + std::to_string(group_size)
+         + ": p50=" + percentile(0.5) + ", p99=" + percentile(0.99) + ", p99.9=" + percentile(0.999)
+         + ", max=" + percentile(1.0));
 }
 
 TEMPLATE_TEST_CASE("Benchmark without distribution reuse", "[!benchmark]",
-    OpenBSD_plain,
-    java_plain,
+    OpenBSD_plain<uint64_t>,
+    ( OpenBSD_plain<uint64_t, reciprocal_threshold> ),
+    java_plain<uint64_t>,
     lemire_plain_templated_mult<NaiveMult>,
     lemire_plain_templated_mult<OptimizedMult>,
-    lemire_plain_templated_mult<IntrinsicMult>) {
+    lemire_plain_templated_mult<IntrinsicMult>,
+    ( lemire_plain_templated_mult<IntrinsicMult, uint64_t, division_threshold> ),
+    ( lemire_plain_templated_mult<IntrinsicMult, uint64_t, reciprocal_threshold> ),
+    ( lemire_algorithm_no_reuse<uint64_t> ),
+    ( lemire_algorithm_no_reuse<uint64_t, division_threshold> ),
+    ( lemire_algorithm_reuse<uint64_t> ),
+    ( lemire_algorithm_reuse<uint64_t, reciprocal_threshold> ),
+    lemire_canon_templated_mult<NaiveMult>,
+    lemire_canon_templated_mult<OptimizedMult>,
+    lemire_canon_templated_mult<IntrinsicMult>,
+    lemire_adaptive<>) {
 
     size_t iters = GENERATE(100'000, 1'000'000, 10'000'000);
 
@@ -199,9 +939,308 @@ TEMPLATE_TEST_CASE("Benchmark without distribution reuse", "[!benchmark]",
     };
 }
 
+// The table only beats the division while the part of it that gets used
+// stays in the cache. Every entry takes 2 bytes, so the bounds below touch
+// 512 B, 8 kB and the whole 128 kB of it. The distances are random, so the
+// loads cannot be prefetched.
+TEMPLATE_TEST_CASE("Benchmark threshold table footprint", "[!benchmark]", uint32_t, uint64_t) {
+    const uint64_t max_distance = GENERATE(256, 4'096, 65'536);
+    static constexpr size_t count = 1'000'000;
+
+    SimplePcg32 rng;
+    std::vector<TestType> distances(count);
+    for (auto& distance : distances) {
+        distance = static_cast<TestType>(rng() % max_distance + 1);
+    }
+    const auto suffix = ", table bytes=" + std::to_string(max_distance * sizeof(uint16_t));
+
+    BENCHMARK("division" + suffix) {
+        TestType sum = 0;
+        for (auto distance : distances) {
+            sum += division_threshold::compute(same(distance));
+        }
+        return sum;
+    };
+    BENCHMARK("table" + suffix) {
+        TestType sum = 0;
+        for (auto distance : distances) {
+            sum += small_table_threshold<>::compute(same(distance));
+        }
+        return sum;
+    };
+    // generate always computes the threshold, unlike operator()
+    BENCHMARK("noreuse generate with division" + suffix) {
+        TestType sum = 0;
+        TestType out[4];
+        for (auto distance : distances) {
+            lemire_algorithm_no_reuse<TestType, division_threshold> dist(0, distance - 1);
+            dist.generate(out, out + 4, rng);
+            sum += out[0];
+        }
+        return sum;
+    };
+    BENCHMARK("noreuse generate with table" + suffix) {
+        TestType sum = 0;
+        TestType out[4];
+        for (auto distance : distances) {
+            lemire_algorithm_no_reuse<TestType> dist(0, distance - 1);
+            dist.generate(out, out + 4, rng);
+            sum += out[0];
+        }
+        return sum;
+    };
+}
+
+
+TEST_CASE("Distance cache counts hits and misses", "[distributions]") {
+    size_t computed = 0;
+    auto compute = [&](uint64_t distance) {
+        ++computed;
+        return distance * 2;
+    };
+    SECTION("Repeated distance hits") {
+        distance_cache<uint64_t, uint64_t> cache;
+        REQUIRE(cache.get(17, compute) == 34);
+        REQUIRE(cache.get(17, compute) == 34);
+        REQUIRE(cache.get(17, compute) == 34);
+        REQUIRE(computed == 1);
+        REQUIRE(cache.hits() == 2);
+        REQUIRE(cache.misses() == 1);
+
+        cache.invalidate();
+        REQUIRE(cache.get(17, compute) == 34);
+        REQUIRE(cache.misses() == 2);
+        cache.resetCounters();
+        REQUIRE(cache.hits() == 0);
+        REQUIRE(cache.misses() == 0);
+    }
+    SECTION("Distances in the same slot evict each other") {
+        distance_cache<uint64_t, uint64_t, 1> cache;
+        for (int i = 0; i < 10; ++i) {
+            REQUIRE(cache.get(17, compute) == 34);
+            REQUIRE(cache.get(0, compute) == 0);
+        }
+        REQUIRE(cache.hits() == 0);
+        REQUIRE(cache.misses() == 20);
+    }
+    SECTION("A few distances fit into the cache") {
+        distance_cache<uint64_t, uint64_t, 1024> cache;
+        for (int i = 0; i < 10; ++i) {
+            for (uint64_t distance = 1; distance <= 4; ++distance) {
+                REQUIRE(cache.get(distance << 40, compute) == distance << 41);
+            }
+        }
+        REQUIRE(cache.misses() == 4);
+        REQUIRE(cache.hits() == 36);
+    }
+}
+
+TEMPLATE_TEST_CASE("Cached distributions return the same numbers", "[distributions]",
+    java_libdivide<uint64_t>,
+    java_libdivide<int32_t>,
+    OpenBSD_libdivide<uint64_t>,
+    OpenBSD_libdivide<int32_t>,
+    lemire_algorithm_reuse<uint64_t>,
+    lemire_algorithm_reuse<int32_t>) {
+    using result_type = typename TestType::result_type;
+    const auto seed = std::random_device{}();
+    CAPTURE(seed);
+    SimplePcg32 pcg1(seed), pcg2(seed);
+    // Fewer slots than bounds, so that some get evicted. The last bound
+    // is the whole range.
+    typename TestType::template cache_type<4> cache;
+    const result_type bounds[] = { 1, 2, 3, 17, 100, 1567894, (std::numeric_limits<result_type>::max)() / 3,
+                                   (std::numeric_limits<result_type>::max)() - 1,
+                                   (std::numeric_limits<result_type>::max)() };
+    for (size_t i = 0; i < 10'000; ++i) {
+        // Every bound is used a few times in a row, so some lookups must hit
+        const auto bound = bounds[i / 3 % 9];
+        const auto low = bound == (std::numeric_limits<result_type>::max)() ? (std::numeric_limits<result_type>::min)()
+                                                                             : result_type(0);
+        TestType cached(low, bound, cache);
+        TestType uncached(low, bound);
+        REQUIRE(cached(pcg1) == uncached(pcg2));
+    }
+    REQUIRE(cache.hits() + cache.misses() == 10'000);
+    REQUIRE(cache.hits() >= 10'000 * 2 / 3);
+}
+
+namespace {
+    // The first distances are much more common than the last ones, as with
+    // tenants of very different sizes. The i-th of them is picked with
+    // probability proportional to 1 / (i + 1).
+    std::vector<uint64_t> zipfian_bounds(size_t distinct, size_t count) {
+        SimplePcg32 rng;
+        std::vector<uint64_t> values(distinct);
+        std::vector<double> weights(distinct);
+        for (size_t i = 0; i < distinct; ++i) {
+            values[i] = Catch::Detail::fillBitsFrom<uint64_t>(rng) >> 24;
+            weights[i] = 1.0 / double(i + 1);
+        }
+        std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+        std::mt19937 pick_rng;
+        std::vector<uint64_t> bounds(count);
+        for (auto& bound : bounds) {
+            bound = values[pick(pick_rng)];
+        }
+        return bounds;
+    }
+}
+
+TEMPLATE_TEST_CASE("Benchmark cached distributions with Zipfian bounds", "[!benchmark]",
+    java_libdivide<uint64_t>,
+    OpenBSD_libdivide<uint64_t>,
+    lemire_algorithm_reuse<uint64_t>) {
+    const size_t distinct = GENERATE(4, 64, 1024);
+    static constexpr size_t iters = 1'000'000;
+    // Cycled through, so that they stay in L2
+    static constexpr size_t sequence_length = 1 << 16;
+    const auto bounds = zipfian_bounds(distinct, sequence_length);
+
+    // The hit rate depends only on the bounds, so it can be measured once
+    auto hit_rate = [&](auto& cache) {
+        for (size_t n = 0; n < iters; ++n) {
+            TestType dist(0, bounds[n % sequence_length], cache);
+        }
+        return std::to_string(100 * cache.hits() / (cache.hits() + cache.misses())) + "% hits";
+    };
+    typename TestType::template cache_type<> cache;
+    typename TestType::template cache_type<1024> large_cache;
+    const auto small_hits = hit_rate(cache);
+    const auto large_hits = hit_rate(large_cache);
+    const auto suffix = ", distinct bounds=" + std::to_string(distinct);
+
+    SimplePcg32 rng;
+    BENCHMARK("uncached" + suffix) {
+        uint64_t sum = 0;
+        for (size_t n = 0; n < iters; ++n) {
+            TestType dist(0, bounds[n % sequence_length]);
+            sum += dist(rng);
+        }
+        return sum;
+    };
+    BENCHMARK("cached, " + small_hits + suffix) {
+        uint64_t sum = 0;
+        for (size_t n = 0; n < iters; ++n) {
+            TestType dist(0, bounds[n % sequence_length], cache);
+            sum += dist(rng);
+        }
+        return sum;
+    };
+    BENCHMARK("cached with 1024 slots, " + large_hits + suffix) {
+        uint64_t sum = 0;
+        for (size_t n = 0; n < iters; ++n) {
+            TestType dist(0, bounds[n % sequence_length], large_cache);
+            sum += dist(rng);
+        }
+        return sum;
+    };
+}
+
+TEMPLATE_TEST_CASE("Restored distributions continue bit-identically", "[reproducibility]",
+    OpenBSD_plain<uint64_t>,
+    OpenBSD_reuse<uint64_t>,
+    OpenBSD_libdivide<uint64_t>,
+    java_plain<uint64_t>,
+    java_reuse<uint64_t>,
+    java_libdivide<uint64_t>,
+    bitmask_plain,
+    bitmask_reuse,
+    lemire_plain_templated_mult<IntrinsicMult>,
+    lemire_reuse_templated_mult<IntrinsicMult>,
+    lemire_canon_templated_mult<IntrinsicMult>,
+    lemire_algorithm_no_reuse<uint64_t>,
+    lemire_algorithm_reuse<uint64_t>,
+    lemire_algorithm_lazy_reuse<uint64_t>,
+    lemire_batched<uint64_t>,
+    lemire_adaptive<>) {
+    // The last bound rejects often enough that the lazy variant will
+    // have computed its threshold by the time we checkpoint it.
+    auto bound = GENERATE(as<uint64_t>{}, 17, 1567894, 12298110947468241578);
+    const auto seed = std::random_device{}();
+    CAPTURE(bound, seed);
+
+    SimplePcg32 pcg(seed);
+    TestType dist(3, bound);
+    for (size_t i = 0; i < 1'000; ++i) {
+        dist(pcg);
+    }
+
+    checkpoint_writer writer;
+    pcg.save(writer);
+    dist.save(writer);
+
+    std::vector<uint64_t> expected;
+    for (size_t i = 0; i < 1'000; ++i) {
+        expected.push_back(dist(pcg));
+    }
+
+    SimplePcg32 restored_pcg;
+    TestType restored_dist(0, 0);
+    checkpoint_reader reader(writer.bytes());
+    restored_pcg.restore(reader);
+    restored_dist.restore(reader);
+    REQUIRE(reader.remaining() == 0);
+    for (auto e : expected) {
+        REQUIRE(restored_dist(restored_pcg) == e);
+    }
+    REQUIRE(restored_pcg == pcg);
+
+    // A truncated checkpoint must leave the distribution as it was
+    checkpoint_writer dist_writer;
+    dist.save(dist_writer);
+    checkpoint_reader truncated(dist_writer.bytes().data(), dist_writer.bytes().size() - 1);
+    TestType untouched(5, 9), reference(5, 9);
+    REQUIRE_THROWS_AS(untouched.restore(truncated), std::runtime_error);
+    SimplePcg32 pcg1(seed), pcg2(seed);
+    for (size_t i = 0; i < 100; ++i) {
+        REQUIRE(untouched(pcg1) == reference(pcg2));
+    }
+}
+
+TEST_CASE("Truncated checkpoint is rejected", "[reproducibility]") {
+    checkpoint_writer writer;
+    SimplePcg32 pcg(std::random_device{}());
+    pcg.save(writer);
+    SimplePcg32 restored;
+    checkpoint_reader reader(writer.bytes().data(), writer.bytes().size() - 1);
+    REQUIRE_THROWS_AS(restored.restore(reader), std::runtime_error);
+    // Nothing was overwritten
+    REQUIRE(restored == SimplePcg32{});
+}
+
+TEMPLATE_TEST_CASE("Benchmark checkpoint", "[!benchmark]",
+    java_reuse<uint64_t>,
+    OpenBSD_libdivide<uint64_t>,
+    lemire_reuse_templated_mult<IntrinsicMult>,
+    lemire_algorithm_lazy_reuse<uint64_t>) {
+    SimplePcg32 pcg;
+    TestType dist(0, same(uint64_t(1567894)));
+    checkpoint_writer writer;
+    BENCHMARK("save") {
+        writer.clear();
+        pcg.save(writer);
+        dist.save(writer);
+        return writer.bytes().size();
+    };
+    BENCHMARK("restore") {
+        checkpoint_reader reader(writer.bytes());
+        pcg.restore(reader);
+        dist.restore(reader);
+        return reader.remaining();
+    };
+}
+
+namespace {
+    // Never batches and never gives up on exact uniformity
+    struct ExactAdaptiveThresholds {
+        static constexpr uint64_t max_batched_distance = 0;
+        static constexpr uint64_t min_rejection_free_threshold = UINT64_MAX;
+    };
+}
 
 template <typename Dist1, typename Dist2>
-void CheckEqualResultsForDists( uint64_t a, uint64_t b ) {
+void CheckEqualResultsForDists( typename Dist1::result_type a, typename Dist1::result_type b ) {
     Dist1 d1( a, b );
     Dist2 d2( a, b );
     const auto rand_seed = std::random_device{}();
@@ -213,17 +1252,72 @@ void CheckEqualResultsForDists( uint64_t a, uint64_t b ) {
 }
 
 TEST_CASE( "Check that different distribution variants have the same results", "[distributions]" ) {
-    CheckEqualResultsForDists<java_plain, java_reuse>( 3, 17 );
-    CheckEqualResultsForDists<java_plain, java_reuse>( 7, 1567894 );
-    CheckEqualResultsForDists<java_plain, java_libdivide>( 3, 17 );
-    CheckEqualResultsForDists<java_plain, java_libdivide>( 7, 1567894 );
+    CheckEqualResultsForDists<java_plain<uint64_t>, java_reuse<uint64_t>>( 3, 17 );
+    CheckEqualResultsForDists<java_plain<uint64_t>, java_reuse<uint64_t>>( 7, 1567894 );
+    CheckEqualResultsForDists<java_plain<>, java_libdivide<>>( 3, 17 );
+    CheckEqualResultsForDists<java_plain<uint64_t>, java_libdivide<uint64_t>>( 7, 1567894 );
+
+    CheckEqualResultsForDists<OpenBSD_plain<uint64_t>, OpenBSD_reuse<uint64_t>>( 3, 17 );
+    CheckEqualResultsForDists<OpenBSD_plain<uint64_t>, OpenBSD_reuse<uint64_t>>( 7, 1567894 );
+    CheckEqualResultsForDists<OpenBSD_plain<>, OpenBSD_libdivide<>>( 3, 17 );
+    CheckEqualResultsForDists<OpenBSD_plain<uint64_t>, OpenBSD_libdivide<uint64_t>>( 7, 1567894 );
 
-    CheckEqualResultsForDists<OpenBSD_plain, OpenBSD_reuse>( 3, 17 );
-    CheckEqualResultsForDists<OpenBSD_plain, OpenBSD_reuse>( 7, 1567894 );
-    CheckEqualResultsForDists<OpenBSD_plain, OpenBSD_libdivide>( 3, 17 );
-    CheckEqualResultsForDists<OpenBSD_plain, OpenBSD_libdivide>( 7, 1567894 );
+    CheckEqualResultsForDists<OpenBSD_plain<uint64_t>, OpenBSD_plain<uint64_t, reciprocal_threshold>>( 3, 17 );
+    CheckEqualResultsForDists<OpenBSD_plain<uint64_t>, OpenBSD_plain<uint64_t, reciprocal_threshold>>(
+        7, 12298110947468241578ULL );
+
+    CheckEqualResultsForDists<bitmask_plain, bitmask_reuse>( 3, 17 );
+    CheckEqualResultsForDists<bitmask_plain, bitmask_reuse>( 7, 1567894 );
 
     CheckEqualResultsForDists<lemire_plain_templated_mult<IntrinsicMult>, lemire_reuse_templated_mult<IntrinsicMult>>( 3, 17 );
     CheckEqualResultsForDists<lemire_plain_templated_mult<IntrinsicMult>, lemire_reuse_templated_mult<IntrinsicMult>>(
         7, 1567894 );
+
+    // The last bound rejects often, so the threshold is actually used
+    using reciprocal_plain = lemire_plain_templated_mult<IntrinsicMult, uint64_t, reciprocal_threshold>;
+    CheckEqualResultsForDists<lemire_plain_templated_mult<IntrinsicMult>, reciprocal_plain>( 3, 17 );
+    CheckEqualResultsForDists<lemire_plain_templated_mult<IntrinsicMult>, reciprocal_plain>( 7, 12298110947468241578ULL );
+    CheckEqualResultsForDists<lemire_algorithm_no_reuse<uint64_t>, lemire_algorithm_no_reuse<uint64_t, reciprocal_threshold>>(
+        7, 12298110947468241578ULL );
+    CheckEqualResultsForDists<lemire_algorithm_reuse<uint64_t>, lemire_algorithm_reuse<uint64_t, reciprocal_threshold>>(
+        7, 1567894 );
+
+    CheckEqualResultsForDists<lemire_canon_templated_mult<NaiveMult>, lemire_canon_templated_mult<IntrinsicMult>>( 3, 17 );
+    CheckEqualResultsForDists<lemire_canon_templated_mult<NaiveMult>, lemire_canon_templated_mult<IntrinsicMult>>(
+        7, 12298110947468241578ULL );
+
+    // lemire_adaptive picks a different variant for each of these
+    CheckEqualResultsForDists<lemire_adaptive<>, lemire_batched<uint64_t>>( 3, 17 );
+    CheckEqualResultsForDists<lemire_adaptive<>, lemire_batched<uint64_t>>( 7, 1567894 );
+    CheckEqualResultsForDists<lemire_adaptive<>, lemire_reuse_templated_mult<IntrinsicMult>>( 7, ( uint64_t( 1 ) << 40 ) + 6 );
+    CheckEqualResultsForDists<lemire_adaptive<>, lemire_reuse_templated_mult<IntrinsicMult>>( 7, uint64_t( 1 ) << 40 );
+    CheckEqualResultsForDists<lemire_adaptive<>, lemire_canon_templated_mult<IntrinsicMult>>(
+        7, 12298110947468241578ULL );
+    CheckEqualResultsForDists<lemire_adaptive<ExactAdaptiveThresholds>, lemire_reuse_templated_mult<IntrinsicMult>>( 3, 17 );
+    CheckEqualResultsForDists<lemire_adaptive<ExactAdaptiveThresholds>, lemire_reuse_templated_mult<IntrinsicMult>>(
+        7, 12298110947468241578ULL );
+}
+
+TEMPLATE_TEST_CASE( "Check that different distribution variants have the same results for other integer types",
+                    "[distributions]", int8_t, uint8_t, int16_t, uint16_t, int32_t, uint32_t, int64_t ) {
+    using limits = std::numeric_limits<TestType>;
+    const TestType low = std::is_signed<TestType>::value ? -20 : 3;
+    const TestType high = static_cast<TestType>( low + 97 );
+
+    CheckEqualResultsForDists<java_plain<TestType>, java_reuse<TestType>>( low, high );
+    CheckEqualResultsForDists<java_plain<TestType>, java_libdivide<TestType>>( low, high );
+    CheckEqualResultsForDists<java_plain<TestType>, java_libdivide<TestType>>( limits::min(), limits::max() - 1 );
+
+    CheckEqualResultsForDists<OpenBSD_plain<TestType>, OpenBSD_reuse<TestType>>( low, high );
+    CheckEqualResultsForDists<OpenBSD_plain<TestType>, OpenBSD_libdivide<TestType>>( low, high );
+    CheckEqualResultsForDists<OpenBSD_plain<TestType>, OpenBSD_libdivide<TestType>>( limits::min(), limits::max() - 1 );
+
+    CheckEqualResultsForDists<OpenBSD_plain<TestType>, OpenBSD_plain<TestType, reciprocal_threshold>>( low, high );
+
+    CheckEqualResultsForDists<lemire_plain_intrinsic<TestType>, lemire_reuse_intrinsic<TestType>>( low, high );
+    CheckEqualResultsForDists<lemire_algorithm_reuse<TestType>, lemire_algorithm_reuse<TestType, reciprocal_threshold>>(
+        low, high );
+    CheckEqualResultsForDists<lemire_reuse_intrinsic<TestType>, lemire_algorithm_reuse<TestType>>( low, high );
+    CheckEqualResultsForDists<lemire_reuse_intrinsic<TestType>, lemire_algorithm_reuse<TestType>>(
+        limits::min(), limits::max() - 1 );
 }
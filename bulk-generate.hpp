@@ -0,0 +1,472 @@
+#pragma once
+
+#include "emul.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#    include <immintrin.h>
+#    define BULK_USE_AVX2_DISPATCH
+#endif
+
+namespace detail {
+    // Thresholds above this reject more than 1 in 32 draws. That is where
+    // the bulk paths started winning over drawing the numbers one by one,
+    // with PCG and xoshiro generators on x86-64.
+    template <typename UInt>
+    inline constexpr UInt frequent_rejection_threshold = static_cast<UInt>( -1 ) >> 5;
+
+    template <typename T>
+    struct BulkCandidate {
+        T value;
+        bool rejected;
+    };
+
+    // Fills [first, last) with values from `attempt(g)`, which returns
+    // a BulkCandidate. Rejected candidates are not retried inline, instead
+    // their slots are recorded (without branching) and refilled once the
+    // whole chunk is done. This keeps the rejection branch, which is almost
+    // never taken, out of the main loop.
+    //
+    // Note that the order in which the values are drawn differs from calling
+    // the distribution N times, so the results differ when rejection happens.
+    template <typename RandomIt, typename Generator, typename Attempt>
+    void generateWithDeferredRejection( RandomIt first, RandomIt last, Generator& g, Attempt attempt ) {
+        constexpr std::size_t chunk_size = 256;
+        std::uint32_t rejected_slots[chunk_size];
+
+        while ( first != last ) {
+            const auto chunk = std::min( chunk_size, static_cast<std::size_t>( last - first ) );
+            std::size_t rejected_count = 0;
+            for ( std::size_t i = 0; i < chunk; ++i ) {
+                const auto candidate = attempt( g );
+                first[i] = candidate.value;
+                rejected_slots[rejected_count] = static_cast<std::uint32_t>( i );
+                rejected_count += candidate.rejected;
+            }
+            for ( std::size_t r = 0; r < rejected_count; ++r ) {
+                auto candidate = attempt( g );
+                while ( candidate.rejected ) {
+                    candidate = attempt( g );
+                }
+                first[rejected_slots[r]] = candidate.value;
+            }
+            first += chunk;
+        }
+    }
+
+    // Lemire's method for 32 bit numbers, applied to `count` random numbers
+    // at once. Writes `a + upper half` for every accepted number to `out`,
+    // in order, and returns how many were accepted. Rejected numbers are
+    // simply dropped, so the outputs are the same as if the distribution
+    // was called until it used up all of `bits`.
+    //
+    // The buffers are templated rather than std::uint32_t, so that callers
+    // with another unsigned type of the same size do not have to cast them.
+    template <typename UInt>
+    std::size_t lemireFilter32Scalar( const UInt* bits, std::size_t count, std::uint32_t a, std::uint32_t distance,
+                                      std::uint32_t threshold, UInt* out ) {
+        static_assert( std::is_unsigned<UInt>::value && sizeof( UInt ) == sizeof( std::uint32_t ), "..." );
+        std::size_t accepted = 0;
+        for ( std::size_t i = 0; i < count; ++i ) {
+            const std::uint64_t product = std::uint64_t( bits[i] ) * distance;
+            out[accepted] = a + static_cast<std::uint32_t>( product >> 32 );
+            accepted += static_cast<std::uint32_t>( product ) >= threshold;
+        }
+        return accepted;
+    }
+
+#if defined( BULK_USE_AVX2_DISPATCH )
+    // For every 8 bit mask of accepted lanes, the indices of the accepted
+    // lanes, packed one per byte, so that they can be moved to the front.
+    struct CompressTable {
+        std::uint64_t entries[256];
+    };
+
+    constexpr CompressTable makeCompressTable() {
+        CompressTable table{};
+        for ( unsigned mask = 0; mask < 256; ++mask ) {
+            std::uint64_t entry = 0;
+            unsigned filled = 0;
+            for ( unsigned lane = 0; lane < 8; ++lane ) {
+                if ( mask & ( 1u << lane ) ) {
+                    entry |= std::uint64_t( lane ) << ( 8 * filled++ );
+                }
+            }
+            table.entries[mask] = entry;
+        }
+        return table;
+    }
+
+    inline constexpr CompressTable compress_table = makeCompressTable();
+
+    // Same as lemireFilter32Scalar, but does 8 numbers at once.
+    // _mm256_mul_epu32 only multiplies the even 32 bit lanes, so the odd
+    // lanes are shifted down and multiplied separately.
+    template <typename UInt>
+    __attribute__((target("avx2")))
+    std::size_t lemireFilter32AVX2( const UInt* bits, std::size_t count, std::uint32_t a, std::uint32_t distance,
+                                    std::uint32_t threshold, UInt* out ) {
+        const __m256i vdistance = _mm256_set1_epi32( static_cast<int>( distance ) );
+        const __m256i vthreshold = _mm256_set1_epi32( static_cast<int>( threshold ) );
+        const __m256i va = _mm256_set1_epi32( static_cast<int>( a ) );
+
+        std::size_t accepted = 0;
+        std::size_t i = 0;
+        for ( ; i + 8 <= count; i += 8 ) {
+            const __m256i x = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( bits + i ) );
+            const __m256i even = _mm256_mul_epu32( x, vdistance );
+            const __m256i odd = _mm256_mul_epu32( _mm256_srli_epi64( x, 32 ), vdistance );
+            const __m256i lower = _mm256_blend_epi32( even, _mm256_slli_epi64( odd, 32 ), 0xAA );
+            const __m256i upper = _mm256_blend_epi32( _mm256_srli_epi64( even, 32 ), odd, 0xAA );
+
+            // There is no unsigned comparison, but lower >= threshold
+            // iff max(lower, threshold) == lower
+            const __m256i keep = _mm256_cmpeq_epi32( _mm256_max_epu32( lower, vthreshold ), lower );
+            const unsigned mask = static_cast<unsigned>( _mm256_movemask_ps( _mm256_castsi256_ps( keep ) ) );
+
+            // A load rather than _mm_cvtsi64_si128, which 32 bit x86 lacks
+            const __m256i indices = _mm256_cvtepu8_epi32(
+                _mm_loadl_epi64( reinterpret_cast<const __m128i*>( &compress_table.entries[mask] ) ) );
+            const __m256i packed = _mm256_permutevar8x32_epi32( _mm256_add_epi32( upper, va ), indices );
+            // accepted <= i, so the whole store stays within out[0, count)
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + accepted ), packed );
+            accepted += static_cast<std::size_t>( __builtin_popcount( mask ) );
+        }
+        return accepted + lemireFilter32Scalar( bits + i, count - i, a, distance, threshold, out + accepted );
+    }
+#endif
+
+    // The 64 bit version of lemireFilter32Scalar
+    template <typename UInt>
+    std::size_t lemireFilter64Scalar( const UInt* bits, std::size_t count, std::uint64_t a, std::uint64_t distance,
+                                      std::uint64_t threshold, UInt* out ) {
+        static_assert( std::is_unsigned<UInt>::value && sizeof( UInt ) == sizeof( std::uint64_t ), "..." );
+        std::size_t accepted = 0;
+        for ( std::size_t i = 0; i < count; ++i ) {
+#if defined( USE_UINT128 ) || defined( USE_MSVC_UMUL )
+            const auto product = ext_mul_intrinsic( bits[i], distance );
+#else
+            const auto product = ext_mul_optimized( bits[i], distance );
+#endif
+            out[accepted] = a + product.upper;
+            accepted += product.lower >= threshold;
+        }
+        return accepted;
+    }
+
+#if defined( BULK_USE_AVX2_DISPATCH )
+    // Same as lemireFilter64Scalar, but does 8 numbers at once. AVX-512
+    // has no 64x64 -> 128 bit multiply, so the product is put together from
+    // 32x32 bit partial products, the same way ext_mul_optimized does it.
+    //
+    // GCC 12 warns about the uninitialized placeholder inside its own
+    // AVX-512 intrinsics (GCC bug 105593), so the warning is disabled here.
+#    if defined( __GNUC__ ) && !defined( __clang__ )
+#        pragma GCC diagnostic push
+#        pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#    endif
+    template <typename UInt>
+    __attribute__((target("avx512f")))
+    std::size_t lemireFilter64AVX512( const UInt* bits, std::size_t count, std::uint64_t a, std::uint64_t distance,
+                                      std::uint64_t threshold, UInt* out ) {
+        const __m512i low_mask = _mm512_set1_epi64( 0xFFFF'FFFF );
+        const __m512i distance_low = _mm512_set1_epi64( static_cast<long long>( distance & 0xFFFF'FFFF ) );
+        const __m512i distance_high = _mm512_set1_epi64( static_cast<long long>( distance >> 32 ) );
+        const __m512i vthreshold = _mm512_set1_epi64( static_cast<long long>( threshold ) );
+        const __m512i va = _mm512_set1_epi64( static_cast<long long>( a ) );
+
+        std::size_t accepted = 0;
+        for ( std::size_t i = 0; i < count; i += 8 ) {
+            // The last block is partial, the lanes past the end are
+            // masked out from both the load and the results.
+            const __mmask8 valid = count - i >= 8 ? __mmask8( 0xFF ) : __mmask8( ( 1u << ( count - i ) ) - 1 );
+            const __m512i x = _mm512_maskz_loadu_epi64( valid, bits + i );
+            const __m512i x_high = _mm512_srli_epi64( x, 32 );
+
+            const __m512i low_low = _mm512_mul_epu32( x, distance_low );
+            const __m512i high_high = _mm512_mul_epu32( x_high, distance_high );
+            const __m512i high_low = _mm512_add_epi64( _mm512_mul_epu32( x_high, distance_low ),
+                                                       _mm512_srli_epi64( low_low, 32 ) );
+            const __m512i low_high = _mm512_add_epi64( _mm512_mul_epu32( x, distance_high ),
+                                                       _mm512_and_si512( high_low, low_mask ) );
+            const __m512i upper = _mm512_add_epi64(
+                high_high, _mm512_add_epi64( _mm512_srli_epi64( high_low, 32 ), _mm512_srli_epi64( low_high, 32 ) ) );
+            const __m512i lower =
+                _mm512_or_si512( _mm512_slli_epi64( low_high, 32 ), _mm512_and_si512( low_low, low_mask ) );
+
+            const __mmask8 keep = _mm512_mask_cmpge_epu64_mask( valid, lower, vthreshold );
+            // Compressing in a register and doing a plain store is much
+            // faster than a compressing store on some CPUs. Like in the AVX2
+            // version, accepted <= i, so a full block stays within out.
+            const __m512i packed = _mm512_maskz_compress_epi64( keep, _mm512_add_epi64( upper, va ) );
+            if ( valid == 0xFF ) {
+                _mm512_storeu_si512( out + accepted, packed );
+            } else {
+                _mm512_mask_storeu_epi64( out + accepted, valid, packed );
+            }
+            accepted += static_cast<std::size_t>( __builtin_popcount( keep ) );
+        }
+        return accepted;
+    }
+#    if defined( __GNUC__ ) && !defined( __clang__ )
+#        pragma GCC diagnostic pop
+#    endif
+#endif
+
+    // Writes in[i] % divisor to out[i] for every i < count. The quotient
+    // comes from libdivide's branchfree algorithm, so `magic` and `shift`
+    // are the fields of a libdivide_u32/u64_branchfree_t for `divisor`:
+    // q = (((n - mulhi(n, magic)) >> 1) + mulhi(n, magic)) >> shift.
+    template <typename UInt>
+    void remaindersBranchfree32Scalar( const UInt* in, std::size_t count, std::uint32_t magic, unsigned shift,
+                                       std::uint32_t divisor, UInt* out ) {
+        static_assert( std::is_unsigned<UInt>::value && sizeof( UInt ) == sizeof( std::uint32_t ), "..." );
+        for ( std::size_t i = 0; i < count; ++i ) {
+            const auto high = static_cast<std::uint32_t>( ( std::uint64_t( in[i] ) * magic ) >> 32 );
+            const std::uint32_t quotient = ( ( ( in[i] - high ) >> 1 ) + high ) >> shift;
+            out[i] = in[i] - quotient * divisor;
+        }
+    }
+
+    template <typename UInt>
+    void remaindersBranchfree64Scalar( const UInt* in, std::size_t count, std::uint64_t magic, unsigned shift,
+                                       std::uint64_t divisor, UInt* out ) {
+        static_assert( std::is_unsigned<UInt>::value && sizeof( UInt ) == sizeof( std::uint64_t ), "..." );
+        for ( std::size_t i = 0; i < count; ++i ) {
+#if defined( USE_UINT128 ) || defined( USE_MSVC_UMUL )
+            const auto high = ext_mul_intrinsic( in[i], magic ).upper;
+#else
+            const auto high = ext_mul_optimized( in[i], magic ).upper;
+#endif
+            const std::uint64_t quotient = ( ( ( in[i] - high ) >> 1 ) + high ) >> shift;
+            out[i] = in[i] - quotient * divisor;
+        }
+    }
+
+#if defined( BULK_USE_AVX2_DISPATCH )
+    // Same as remaindersBranchfree32Scalar, but does 8 numbers at once.
+    // The upper halves of the products come from two widening multiplies,
+    // one for the even and one for the odd lanes, as in libdivide's
+    // libdivide_mullhi_u32_vec256.
+    template <typename UInt>
+    __attribute__((target("avx2")))
+    void remaindersBranchfree32AVX2( const UInt* in, std::size_t count, std::uint32_t magic, unsigned shift,
+                                     std::uint32_t divisor, UInt* out ) {
+        const __m256i vmagic = _mm256_set1_epi32( static_cast<int>( magic ) );
+        const __m256i vdivisor = _mm256_set1_epi32( static_cast<int>( divisor ) );
+        const __m128i vshift = _mm_cvtsi32_si128( static_cast<int>( shift ) );
+
+        std::size_t i = 0;
+        for ( ; i + 8 <= count; i += 8 ) {
+            const __m256i n = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( in + i ) );
+            const __m256i high_even = _mm256_srli_epi64( _mm256_mul_epu32( n, vmagic ), 32 );
+            const __m256i high_odd = _mm256_mul_epu32( _mm256_srli_epi64( n, 32 ), vmagic );
+            const __m256i high = _mm256_blend_epi32( high_even, high_odd, 0xAA );
+            const __m256i t = _mm256_add_epi32( _mm256_srli_epi32( _mm256_sub_epi32( n, high ), 1 ), high );
+            const __m256i quotient = _mm256_srl_epi32( t, vshift );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i ),
+                                 _mm256_sub_epi32( n, _mm256_mullo_epi32( quotient, vdivisor ) ) );
+        }
+        remaindersBranchfree32Scalar( in + i, count - i, magic, shift, divisor, out + i );
+    }
+
+    // The 64 bit version of remaindersBranchfree32AVX2, 4 numbers at once.
+    // AVX2 has no 64 bit multiplies at all, so both the upper half of
+    // n * magic and the lower half of quotient * divisor are put together
+    // from 32x32 bit partial products, as in libdivide_mullhi_u64_vec256.
+    template <typename UInt>
+    __attribute__((target("avx2")))
+    void remaindersBranchfree64AVX2( const UInt* in, std::size_t count, std::uint64_t magic, unsigned shift,
+                                     std::uint64_t divisor, UInt* out ) {
+        const __m256i low_mask = _mm256_set1_epi64x( 0xFFFF'FFFF );
+        const __m256i magic_low = _mm256_set1_epi64x( static_cast<long long>( magic & 0xFFFF'FFFF ) );
+        const __m256i magic_high = _mm256_set1_epi64x( static_cast<long long>( magic >> 32 ) );
+        const __m256i divisor_low = _mm256_set1_epi64x( static_cast<long long>( divisor & 0xFFFF'FFFF ) );
+        const __m256i divisor_high = _mm256_set1_epi64x( static_cast<long long>( divisor >> 32 ) );
+        const __m128i vshift = _mm_cvtsi32_si128( static_cast<int>( shift ) );
+
+        std::size_t i = 0;
+        for ( ; i + 4 <= count; i += 4 ) {
+            const __m256i n = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( in + i ) );
+            const __m256i n_high = _mm256_srli_epi64( n, 32 );
+
+            const __m256i low_low = _mm256_mul_epu32( n, magic_low );
+            const __m256i high_low = _mm256_add_epi64( _mm256_mul_epu32( n_high, magic_low ),
+                                                       _mm256_srli_epi64( low_low, 32 ) );
+            const __m256i low_high = _mm256_add_epi64( _mm256_mul_epu32( n, magic_high ),
+                                                       _mm256_and_si256( high_low, low_mask ) );
+            const __m256i high = _mm256_add_epi64(
+                _mm256_add_epi64( _mm256_mul_epu32( n_high, magic_high ), _mm256_srli_epi64( high_low, 32 ) ),
+                _mm256_srli_epi64( low_high, 32 ) );
+
+            const __m256i t = _mm256_add_epi64( _mm256_srli_epi64( _mm256_sub_epi64( n, high ), 1 ), high );
+            const __m256i quotient = _mm256_srl_epi64( t, vshift );
+
+            // Only the lower 64 bits of quotient * divisor are needed
+            const __m256i cross = _mm256_add_epi64( _mm256_mul_epu32( _mm256_srli_epi64( quotient, 32 ), divisor_low ),
+                                                    _mm256_mul_epu32( quotient, divisor_high ) );
+            const __m256i product = _mm256_add_epi64( _mm256_mul_epu32( quotient, divisor_low ),
+                                                      _mm256_slli_epi64( cross, 32 ) );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i ), _mm256_sub_epi64( n, product ) );
+        }
+        remaindersBranchfree64Scalar( in + i, count - i, magic, shift, divisor, out + i );
+    }
+#endif
+
+    // Turns counts of steps from `base` into floating point numbers, so
+    // that out[i] = base + steps[i] * step, except that steps[i] == last_step
+    // gives last_value instead. The multiplication and the addition are
+    // rounded separately, the same as in plain C++ without FMA contraction.
+    template <typename FloatType, typename UInt>
+    void stepsToFloatingScalar( const UInt* steps, std::size_t count, FloatType base, FloatType step, UInt last_step,
+                                FloatType last_value, FloatType* out ) {
+        for ( std::size_t i = 0; i < count; ++i ) {
+            out[i] = steps[i] == last_step ? last_value : base + static_cast<FloatType>( steps[i] ) * step;
+        }
+    }
+
+#if defined( BULK_USE_AVX2_DISPATCH )
+    // Same as stepsToFloatingScalar, but does 8 numbers at once. There
+    // is only a signed conversion, so the steps must be below 2^31, which
+    // a float range can never have.
+    __attribute__((target("avx2")))
+    inline void stepsToFloatAVX2( const std::uint32_t* steps, std::size_t count, float base, float step,
+                                  std::uint32_t last_step, float last_value, float* out ) {
+        const __m256 vbase = _mm256_set1_ps( base );
+        const __m256 vstep = _mm256_set1_ps( step );
+        const __m256 vlast_value = _mm256_set1_ps( last_value );
+        const __m256i vlast_step = _mm256_set1_epi32( static_cast<int>( last_step ) );
+
+        std::size_t i = 0;
+        for ( ; i + 8 <= count; i += 8 ) {
+            const __m256i x = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( steps + i ) );
+            const __m256 scaled = _mm256_add_ps( vbase, _mm256_mul_ps( _mm256_cvtepi32_ps( x ), vstep ) );
+            const __m256 is_last = _mm256_castsi256_ps( _mm256_cmpeq_epi32( x, vlast_step ) );
+            _mm256_storeu_ps( out + i, _mm256_blendv_ps( scaled, vlast_value, is_last ) );
+        }
+        stepsToFloatingScalar( steps + i, count - i, base, step, last_step, last_value, out + i );
+    }
+
+    // The 64 bit version of stepsToFloatAVX2, 4 numbers at once. AVX2 cannot
+    // convert 64 bit integers, so the halves are converted by putting them
+    // into the mantissa of 2^84 and 2^52, and the sum of those is rounded
+    // just once, the same as a direct conversion.
+    __attribute__((target("avx2")))
+    inline void stepsToDoubleAVX2( const std::uint64_t* steps, std::size_t count, double base, double step,
+                                   std::uint64_t last_step, double last_value, double* out ) {
+        const __m256d vbase = _mm256_set1_pd( base );
+        const __m256d vstep = _mm256_set1_pd( step );
+        const __m256d vlast_value = _mm256_set1_pd( last_value );
+        const __m256i vlast_step = _mm256_set1_epi64x( static_cast<long long>( last_step ) );
+        // 2^84 and 2^52
+        const __m256i high_exponent = _mm256_set1_epi64x( 0x4530'0000'0000'0000 );
+        const __m256i low_exponent = _mm256_set1_epi64x( 0x4330'0000'0000'0000 );
+        const __m256d both_exponents = _mm256_set1_pd( 19342813118337666422669312.0 ); // 2^84 + 2^52
+
+        std::size_t i = 0;
+        for ( ; i + 4 <= count; i += 4 ) {
+            const __m256i x = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( steps + i ) );
+            const __m256d high = _mm256_castsi256_pd( _mm256_or_si256( _mm256_srli_epi64( x, 32 ), high_exponent ) );
+            const __m256d low = _mm256_castsi256_pd( _mm256_blend_epi32( x, low_exponent, 0xAA ) );
+            const __m256d converted = _mm256_add_pd( _mm256_sub_pd( high, both_exponents ), low );
+            const __m256d scaled = _mm256_add_pd( vbase, _mm256_mul_pd( converted, vstep ) );
+            const __m256d is_last = _mm256_castsi256_pd( _mm256_cmpeq_epi64( x, vlast_step ) );
+            _mm256_storeu_pd( out + i, _mm256_blendv_pd( scaled, vlast_value, is_last ) );
+        }
+        stepsToFloatingScalar( steps + i, count - i, base, step, last_step, last_value, out + i );
+    }
+#endif
+
+    inline bool hasAVX2() {
+#if defined( BULK_USE_AVX2_DISPATCH )
+        static const bool has_avx2 = __builtin_cpu_supports( "avx2" );
+        return has_avx2;
+#else
+        return false;
+#endif
+    }
+
+    inline bool hasAVX512() {
+#if defined( BULK_USE_AVX2_DISPATCH )
+        static const bool has_avx512 = __builtin_cpu_supports( "avx512f" );
+        return has_avx512;
+#else
+        return false;
+#endif
+    }
+
+    template <typename UInt>
+    std::size_t lemireFilter32( const UInt* bits, std::size_t count, std::uint32_t a, std::uint32_t distance,
+                                std::uint32_t threshold, UInt* out ) {
+#if defined( BULK_USE_AVX2_DISPATCH )
+        if ( hasAVX2() ) {
+            return lemireFilter32AVX2( bits, count, a, distance, threshold, out );
+        }
+#endif
+        return lemireFilter32Scalar( bits, count, a, distance, threshold, out );
+    }
+
+    template <typename UInt>
+    std::size_t lemireFilter64( const UInt* bits, std::size_t count, std::uint64_t a, std::uint64_t distance,
+                                std::uint64_t threshold, UInt* out ) {
+#if defined( BULK_USE_AVX2_DISPATCH )
+        if ( hasAVX512() ) {
+            return lemireFilter64AVX512( bits, count, a, distance, threshold, out );
+        }
+#endif
+        return lemireFilter64Scalar( bits, count, a, distance, threshold, out );
+    }
+
+    inline void stepsToFloating( const std::uint32_t* steps, std::size_t count, float base, float step,
+                                 std::uint32_t last_step, float last_value, float* out ) {
+#if defined( BULK_USE_AVX2_DISPATCH )
+        if ( hasAVX2() ) {
+            stepsToFloatAVX2( steps, count, base, step, last_step, last_value, out );
+            return;
+        }
+#endif
+        stepsToFloatingScalar( steps, count, base, step, last_step, last_value, out );
+    }
+
+    inline void stepsToFloating( const std::uint64_t* steps, std::size_t count, double base, double step,
+                                 std::uint64_t last_step, double last_value, double* out ) {
+#if defined( BULK_USE_AVX2_DISPATCH )
+        if ( hasAVX2() ) {
+            stepsToDoubleAVX2( steps, count, base, step, last_step, last_value, out );
+            return;
+        }
+#endif
+        stepsToFloatingScalar( steps, count, base, step, last_step, last_value, out );
+    }
+
+    // Picked by size rather than type, because unsigned long long and
+    // std::uint64_t can be different types. The kernels are templated on
+    // the buffer type, so the buffers need no casts.
+    template <typename UInt>
+    void remaindersBranchfree( const UInt* in, std::size_t count, UInt magic, unsigned shift, UInt divisor,
+                               UInt* out ) {
+        static_assert( sizeof( UInt ) == sizeof( std::uint32_t ) || sizeof( UInt ) == sizeof( std::uint64_t ),
+                       "libdivide's branchfree dividers are 32 or 64 bit" );
+        if constexpr ( sizeof( UInt ) == sizeof( std::uint32_t ) ) {
+#if defined( BULK_USE_AVX2_DISPATCH )
+            if ( hasAVX2() ) {
+                remaindersBranchfree32AVX2( in, count, magic, shift, divisor, out );
+                return;
+            }
+#endif
+            remaindersBranchfree32Scalar( in, count, magic, shift, divisor, out );
+        } else {
+#if defined( BULK_USE_AVX2_DISPATCH )
+            if ( hasAVX2() ) {
+                remaindersBranchfree64AVX2( in, count, magic, shift, divisor, out );
+                return;
+            }
+#endif
+            remaindersBranchfree64Scalar( in, count, magic, shift, divisor, out );
+        }
+    }
+} // namespace detail
@@ -0,0 +1,54 @@
+#pragma once
+
+// Minimal binary (de)serialization for engine and distribution state.
+//
+// The values are stored as their raw bytes, so a checkpoint can only be
+// restored on a platform with the same sizes and endianness. This is
+// fine for restarting a long simulation on the same machine, which is
+// what this is meant for.
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+class checkpoint_writer {
+    std::vector<unsigned char> m_bytes;
+
+public:
+    template <typename T>
+    void write( T const& value ) {
+        static_assert( std::is_trivially_copyable<T>::value, "Only trivially copyable types can be written" );
+        const auto old_size = m_bytes.size();
+        m_bytes.resize( old_size + sizeof( T ) );
+        std::memcpy( m_bytes.data() + old_size, &value, sizeof( T ) );
+    }
+
+    std::vector<unsigned char> const& bytes() const { return m_bytes; }
+    void clear() { m_bytes.clear(); }
+};
+
+class checkpoint_reader {
+    const unsigned char* m_pos;
+    const unsigned char* m_end;
+
+public:
+    checkpoint_reader( const unsigned char* data, std::size_t size ): m_pos( data ), m_end( data + size ) {}
+    explicit checkpoint_reader( std::vector<unsigned char> const& bytes ):
+        checkpoint_reader( bytes.data(), bytes.size() ) {}
+
+    template <typename T>
+    T read() {
+        static_assert( std::is_trivially_copyable<T>::value, "Only trivially copyable types can be read" );
+        if ( static_cast<std::size_t>( m_end - m_pos ) < sizeof( T ) ) {
+            throw std::runtime_error( "Checkpoint is truncated" );
+        }
+        T value;
+        std::memcpy( &value, m_pos, sizeof( T ) );
+        m_pos += sizeof( T );
+        return value;
+    }
+
+    std::size_t remaining() const { return static_cast<std::size_t>( m_end - m_pos ); }
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+// Direct-mapped cache for the values that distributions precompute from
+// their distance, such as the rejection threshold or a libdivide divider.
+// Workloads that construct a distribution per request, but cycle through
+// a few bounds, can then keep most of the advantage of reusing one.
+//
+// Every distance maps to a single slot, and a miss simply overwrites it.
+// The distances are hashed first, so that bounds with the same low bits,
+// such as powers of two, do not all fight over one slot.
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+template <typename Distance, typename Value, std::size_t Slots = 64>
+class distance_cache {
+    static_assert( std::is_unsigned<Distance>::value, "Distances are unsigned" );
+    static_assert( Slots > 0 && ( Slots & ( Slots - 1 ) ) == 0, "The number of slots must be a power of two" );
+
+    struct Slot {
+        Distance distance{};
+        bool valid = false;
+        Value value{};
+    };
+
+    static constexpr unsigned slotBits() {
+        unsigned bits = 0;
+        while ( ( std::size_t( 1 ) << bits ) < Slots ) {
+            ++bits;
+        }
+        return bits;
+    }
+
+    // Fibonacci hashing, the top bits of the product are the best mixed
+    static std::size_t slotFor( Distance distance ) {
+        if constexpr ( Slots == 1 ) {
+            return 0;
+        } else {
+            return static_cast<std::size_t>( ( std::uint64_t( distance ) * 0x9e3779b97f4a7c15ULL ) >>
+                                             ( 64 - slotBits() ) );
+        }
+    }
+
+public:
+    using value_type = Value;
+
+    // Returns the value cached for `distance`, computing it with
+    // `compute( distance )` first if it is not there.
+    template <typename Compute>
+    Value const& get( Distance distance, Compute&& compute ) {
+        Slot& slot = m_slots[slotFor( distance )];
+        if ( slot.valid && slot.distance == distance ) {
+            ++m_hits;
+            return slot.value;
+        }
+        ++m_misses;
+        slot.distance = distance;
+        slot.value = compute( distance );
+        slot.valid = true;
+        return slot.value;
+    }
+
+    std::uint64_t hits() const { return m_hits; }
+    std::uint64_t misses() const { return m_misses; }
+
+    // Forgets all cached values, but keeps the counters
+    void invalidate() {
+        for ( auto& slot : m_slots ) {
+            slot.valid = false;
+        }
+    }
+    void resetCounters() {
+        m_hits = 0;
+        m_misses = 0;
+    }
+
+private:
+    Slot m_slots[Slots];
+    std::uint64_t m_hits = 0;
+    std::uint64_t m_misses = 0;
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+// Uniform floating point distribution, built on top of the integer
+// distributions in distributions-lemire.hpp.
+//
+// The algorithm is the same as in Catch2's uniform_floating_point_distribution:
+// all the numbers that can be returned are spaced equally, by the largest
+// distance between two neighbouring floats in [a, b]. One of them is picked
+// with an integer distribution, and then scaled into the range. Unlike
+// `a + (b - a) * generate_canonical()`, every returned number is equally
+// likely, and b is returned too.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "bulk-generate.hpp"
+#include "checkpoint.hpp"
+#include "distributions-lemire.hpp"
+
+namespace detail {
+    // The largest distance between two neighbouring floats in [a, b]
+    template <typename FloatType>
+    FloatType gamma(FloatType a, FloatType b) {
+        assert(a <= b);
+        const auto gamma_up = std::nextafter(a, std::numeric_limits<FloatType>::infinity()) - a;
+        const auto gamma_down = b - std::nextafter(b, -std::numeric_limits<FloatType>::infinity());
+        return gamma_up < gamma_down ? gamma_down : gamma_up;
+    }
+
+    // How many steps of size `distance` fit between a and b. The division
+    // is done separately for a and b, because b - a can overflow, and the
+    // rounding error of subtracting the quotients is added back.
+    template <typename DistanceType, typename FloatType>
+    DistanceType countEquidistantFloats(FloatType a, FloatType b, FloatType distance) {
+        assert(a <= b);
+        const auto ag = a / distance;
+        const auto bg = b / distance;
+        const auto s = bg - ag;
+        const auto err = (std::fabs(a) <= std::fabs(b)) ? -ag - (s - bg) : bg - (s + ag);
+        const auto ceil_s = static_cast<DistanceType>(std::ceil(s));
+        return (ceil_s != s) ? ceil_s : ceil_s + (err > 0);
+    }
+
+    // The largest number of steps of size `gamma` that can be taken at once,
+    // without overflowing to infinity. Clamped to what DistanceType can hold.
+    template <typename DistanceType, typename FloatType>
+    DistanceType calculateMaxStepsInOneGo(FloatType gamma) {
+        // gamma is a power of two, so the division is exact
+        const auto steps = std::floor((std::numeric_limits<FloatType>::max)() / gamma);
+        if (steps >= static_cast<FloatType>((std::numeric_limits<DistanceType>::max)())) {
+            return (std::numeric_limits<DistanceType>::max)();
+        }
+        return static_cast<DistanceType>(steps);
+    }
+} // namespace detail
+
+// Returns numbers from [a, b], picking the step from the endpoint with the
+// larger magnitude with lemire_algorithm_reuse. Only float and double are
+// supported, because they have a matching 32 and 64 bit integer type.
+template <typename FloatType>
+class lemire_uniform_real {
+    static_assert(std::is_same<FloatType, float>::value || std::is_same<FloatType, double>::value,
+                  "Only float and double are supported");
+
+    // Float ranges have at most 2^25 steps, double ranges at most 2^54
+    using WidthType = std::conditional_t<std::is_same<FloatType, float>::value, std::uint32_t, std::uint64_t>;
+
+    FloatType m_a;
+    FloatType m_b;
+    FloatType m_ulp_magnitude;
+    WidthType m_floats_in_range;
+    WidthType m_max_steps_in_one_go;
+    lemire_algorithm_reuse<WidthType> m_int_dist;
+    bool m_a_has_leq_magnitude;
+
+    // The steps are counted from the endpoint with the larger magnitude, so
+    // that all of them are representable, and the last step is replaced by
+    // the other endpoint.
+    FloatType base() const { return m_a_has_leq_magnitude ? m_b : m_a; }
+    FloatType step() const { return m_a_has_leq_magnitude ? -m_ulp_magnitude : m_ulp_magnitude; }
+    FloatType lastValue() const { return m_a_has_leq_magnitude ? m_a : m_b; }
+
+    FloatType fromSteps(WidthType steps) const {
+        if (steps == m_floats_in_range) { return lastValue(); }
+        auto from = base();
+        // Ranges wider than max() cannot be crossed in a single step
+        while (steps > m_max_steps_in_one_go) {
+            from += static_cast<FloatType>(m_max_steps_in_one_go) * step();
+            steps -= m_max_steps_in_one_go;
+        }
+        return from + static_cast<FloatType>(steps) * step();
+    }
+
+public:
+    using result_type = FloatType;
+
+    lemire_uniform_real(FloatType a, FloatType b) :
+        m_a(a),
+        m_b(b),
+        m_ulp_magnitude(detail::gamma(a, b)),
+        m_floats_in_range(detail::countEquidistantFloats<WidthType>(a, b, m_ulp_magnitude)),
+        m_max_steps_in_one_go(detail::calculateMaxStepsInOneGo<WidthType>(m_ulp_magnitude)),
+        m_int_dist(0, m_floats_in_range),
+        m_a_has_leq_magnitude(std::fabs(a) <= std::fabs(b)) {
+        assert(a <= b);
+    }
+
+    template <typename Generator>
+    result_type operator()(Generator& g) {
+        return fromSteps(m_int_dist(g));
+    }
+
+    // Fills [first, last) with the same numbers as calling operator()
+    // repeatedly. The steps are generated in bulk, and then converted to
+    // floating point numbers with SIMD when possible. Ranges too wide to
+    // cross in a single step are converted one by one.
+    template <typename RandomIt, typename Generator>
+    void generate(RandomIt first, RandomIt last, Generator& g) {
+        WidthType steps[bulk_chunk_size];
+        FloatType converted[bulk_chunk_size];
+        while (first != last) {
+            const auto count = std::min(bulk_chunk_size, static_cast<std::size_t>(last - first));
+            m_int_dist.generate(steps, steps + count, g);
+            if (m_floats_in_range > m_max_steps_in_one_go) {
+                first = std::transform(steps, steps + count, first, [this](WidthType x) { return fromSteps(x); });
+                continue;
+            }
+            // Pointer outputs can be written in place, without the extra copy
+            if constexpr (std::is_same<RandomIt, FloatType*>::value) {
+                detail::stepsToFloating(steps, count, base(), step(), m_floats_in_range, lastValue(), first);
+                first += count;
+            } else {
+                detail::stepsToFloating(steps, count, base(), step(), m_floats_in_range, lastValue(), converted);
+                first = std::copy(converted, converted + count, first);
+            }
+        }
+    }
+
+    // Everything else is derived from the bounds
+    void save(checkpoint_writer& out) const {
+        out.write(m_a);
+        out.write(m_b);
+    }
+    void restore(checkpoint_reader& in) {
+        const auto a = in.read<FloatType>();
+        const auto b = in.read<FloatType>();
+        *this = lemire_uniform_real(a, b);
+    }
+
+private:
+    static constexpr std::size_t bulk_chunk_size = 256;
+};
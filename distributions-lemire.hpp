@@ -3,9 +3,129 @@
 #include <catch2/internal/catch_random_integer_helpers.hpp>
 #include <catch2/internal/catch_uniform_integer_distribution.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
 
-template <typename IntegerType>
+#include "bulk-generate.hpp"
+#include "checkpoint.hpp"
+#include "distance-cache.hpp"
+#include "emul.hpp"
+#include "engine-adapters.hpp"
+#include "rejection-threshold.hpp"
+
+// Catch2 does not promise that its helpers are usable in constant
+// expressions, so distributions that want to be constexpr use these
+// equivalents instead. They must return the exact same results. The one
+// for fillBitsFrom lives in engine-adapters.hpp.
+namespace detail {
+    template <typename UInt>
+    struct ExtendedMultResult {
+        UInt upper;
+        UInt lower;
+    };
+
+    template <typename UInt>
+    constexpr ExtendedMultResult<UInt> extendedMult(UInt lhs, UInt rhs) {
+        static_assert(std::is_unsigned<UInt>::value, "...");
+        if constexpr (sizeof(UInt) < sizeof(std::uint64_t)) {
+            using WideInt = std::conditional_t<sizeof(UInt) <= 2, std::uint32_t, std::uint64_t>;
+            const auto result = WideInt(lhs) * WideInt(rhs);
+            return { static_cast<UInt>(result >> (CHAR_BIT * sizeof(UInt))), static_cast<UInt>(result) };
+        } else {
+#if defined( __SIZEOF_INT128__ )
+            const auto result = __uint128_t(lhs) * __uint128_t(rhs);
+            return { static_cast<UInt>(result >> 64), static_cast<UInt>(result) };
+#else
+            // Same approach as ext_mul_optimized in emul.hpp
+            const std::uint64_t lhs_low = lhs & 0xFFFF'FFFF;
+            const std::uint64_t rhs_low = rhs & 0xFFFF'FFFF;
+            const std::uint64_t low_low = lhs_low * rhs_low;
+            const std::uint64_t high_high = (lhs >> 32) * (rhs >> 32);
+            const std::uint64_t high_low = (lhs >> 32) * rhs_low + (low_low >> 32);
+            const std::uint64_t low_high = lhs_low * (rhs >> 32) + (high_low & 0xFFFF'FFFF);
+            return { high_high + (high_low >> 32) + (low_high >> 32), (low_high << 32) | (low_low & 0xFFFF'FFFF) };
+#endif
+        }
+    }
+
+    // 64 bit numbers are multiplied by MultImplementation, narrower ones
+    // by a native multiplication of twice their width.
+    template <typename MultImplementation, typename UInt>
+    ExtendedMultResult<UInt> templatedMult(UInt lhs, UInt rhs) {
+        if constexpr (sizeof(UInt) < sizeof(std::uint64_t)) {
+            return extendedMult(lhs, rhs);
+        } else {
+            const auto result = MultImplementation::Mult(lhs, rhs);
+            return { result.upper, result.lower };
+        }
+    }
+
+    template <typename OriginalType, typename UnsignedType>
+    constexpr UnsignedType transposeToNaturalOrder(UnsignedType in) {
+        if constexpr (std::is_signed<OriginalType>::value) {
+            constexpr auto highest_bit = UnsignedType(1) << (sizeof(UnsignedType) * CHAR_BIT - 1);
+            return static_cast<UnsignedType>(in ^ highest_bit);
+        } else {
+            return in;
+        }
+    }
+
+    // Puts a number in [0, bound_at(i)) into out[i] for every i < count,
+    // all from a single 64 bit random number, by multiplying the lower half
+    // of the previous product by the next bound. Returns the lower half of
+    // the last product, the batch must be redrawn if it is below
+    // 2^64 % (the product of all bounds). The product must fit into 64 bits.
+    //
+    // Brackett-Rozinsky & Lemire, "Batched Ranged Random Integer Generation"
+    template <typename Generator, typename BoundAt>
+    std::uint64_t drawBatch(Generator& g, std::size_t count, BoundAt bound_at, std::uint64_t* out) {
+        auto leftover = fillBitsFrom<std::uint64_t>(g);
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto emul = extendedMult(leftover, std::uint64_t(bound_at(i)));
+            out[i] = emul.upper;
+            leftover = emul.lower;
+        }
+        return leftover;
+    }
+
+    struct BatchShape {
+        std::size_t size;
+        // drawBatch's result must be redrawn if it is below this
+        std::uint64_t rejection_threshold;
+    };
+
+    // Takes as many numbers in [0, distance) per batch as the product of
+    // their distances fits into 64 bits, but at most max_size.
+    inline BatchShape batchShapeFor(std::uint64_t distance, std::size_t max_size) {
+        std::size_t size = 1;
+        std::uint64_t product = distance;
+        while (size < max_size && product <= UINT64_MAX / distance) {
+            product *= distance;
+            ++size;
+        }
+        return { size, (~product + 1) % product };
+    }
+
+    // Rounded down, n must not be 0
+    template <typename UInt>
+    constexpr int floorLog2(UInt n) {
+        int result = 0;
+        while (n > 1) {
+            n >>= 1;
+            ++result;
+        }
+        return result;
+    }
+} // namespace detail
+
+// The rejection threshold is computed by ThresholdPolicy, see
+// rejection-threshold.hpp. A new distribution is made for every number, so
+// by default small distances look their threshold up in a table.
+template <typename IntegerType, typename ThresholdPolicy = small_table_threshold<>>
 class lemire_algorithm_no_reuse {
     static_assert(std::is_integral<IntegerType>::value, "...");
 
@@ -18,7 +138,7 @@ class lemire_algorithm_no_reuse {
     }
 
     static UnsignedIntegerType computeRejectionThreshold(UnsignedIntegerType ab_distance) {
-        return (~ab_distance + 1) % ab_distance;
+        return ThresholdPolicy::compute(ab_distance);
     }
 
     static UnsignedIntegerType transposeTo(IntegerType in) {
@@ -56,13 +176,51 @@ public:
             }
         }
 
-        return transposeBack(m_a + emul.upper);
+        return transposeBack(transposeTo(m_a) + emul.upper);
+    }
+
+    // Fills [first, last) with numbers from the distribution, see
+    // detail::generateWithDeferredRejection for how it differs from calling
+    // operator() repeatedly.
+    template <typename RandomIt, typename Generator>
+    void generate(RandomIt first, RandomIt last, Generator& g) {
+        const auto ab_distance = computeDistance(m_a, m_b);
+        if (ab_distance == 0) {
+            for (; first != last; ++first) {
+                *first = transposeBack(Catch::Detail::fillBitsFrom<UnsignedIntegerType>(g));
+            }
+            return;
+        }
+        // For a whole range, computing the threshold up front is cheaper than
+        // checking whether we need it for every number.
+        const auto rejection_threshold = computeRejectionThreshold(ab_distance);
+        const auto a = transposeTo(m_a);
+        detail::generateWithDeferredRejection(first, last, g, [&](Generator& gen) {
+            const auto emul = Catch::Detail::extendedMult(
+                Catch::Detail::fillBitsFrom<UnsignedIntegerType>(gen), ab_distance);
+            return detail::BulkCandidate<IntegerType>{ transposeBack(a + emul.upper),
+                                                       emul.lower < rejection_threshold };
+        });
+    }
+
+    void save(checkpoint_writer& out) const {
+        out.write(m_a);
+        out.write(m_b);
+    }
+    void restore(checkpoint_reader& in) {
+        const auto a = in.read<IntegerType>();
+        const auto b = in.read<IntegerType>();
+        m_a = a;
+        m_b = b;
     }
 };
 
 
 // Implementation yoinked directly from Catch2's uniform_integer_distribution
-template <typename IntegerType>
+// Unlike the other distributions here, it is also usable in constant expressions.
+// The rejection threshold is computed by ThresholdPolicy, so that
+// distributions constructed for a single number can avoid the division.
+template <typename IntegerType, typename ThresholdPolicy = division_threshold>
 class lemire_algorithm_reuse {
     static_assert(std::is_integral<IntegerType>::value, "...");
 
@@ -73,52 +231,155 @@ class lemire_algorithm_reuse {
     UnsignedIntegerType m_ab_distance;
     UnsignedIntegerType m_rejection_threshold;
 
-    UnsignedIntegerType computeDistance(IntegerType a, IntegerType b) const {
+    constexpr UnsignedIntegerType computeDistance(IntegerType a, IntegerType b) const {
         return transposeTo(b) - transposeTo(a) + 1;
     }
 
-    static UnsignedIntegerType computeRejectionThreshold(UnsignedIntegerType ab_distance) {
+    static constexpr UnsignedIntegerType computeRejectionThreshold(UnsignedIntegerType ab_distance) {
         if (ab_distance == 0) { return 0; }
-        return (~ab_distance + 1) % ab_distance;
+        return ThresholdPolicy::compute(ab_distance);
     }
 
-    static UnsignedIntegerType transposeTo(IntegerType in) {
-        return Catch::Detail::transposeToNaturalOrder<IntegerType>(
+    static constexpr UnsignedIntegerType transposeTo(IntegerType in) {
+        return detail::transposeToNaturalOrder<IntegerType>(
             static_cast<UnsignedIntegerType>(in));
     }
-    static IntegerType transposeBack(UnsignedIntegerType in) {
+    static constexpr IntegerType transposeBack(UnsignedIntegerType in) {
         return static_cast<IntegerType>(
-            Catch::Detail::transposeToNaturalOrder<IntegerType>(in));
+            detail::transposeToNaturalOrder<IntegerType>(in));
     }
 
 public:
     using result_type = IntegerType;
 
-    lemire_algorithm_reuse(IntegerType a, IntegerType b) :
+    // Rejection thresholds cached by distance, see distance-cache.hpp
+    template <std::size_t Slots = 64>
+    using cache_type = distance_cache<UnsignedIntegerType, UnsignedIntegerType, Slots>;
+
+    constexpr lemire_algorithm_reuse(IntegerType a, IntegerType b) :
         m_a(transposeTo(a)),
         m_ab_distance(computeDistance(a, b)),
         m_rejection_threshold(computeRejectionThreshold(m_ab_distance)) {
         assert(a <= b);
     }
 
+    // Takes the rejection threshold from `cache`, instead of computing it
+    template <std::size_t Slots>
+    lemire_algorithm_reuse(IntegerType a, IntegerType b, cache_type<Slots>& cache) :
+        m_a(transposeTo(a)),
+        m_ab_distance(computeDistance(a, b)),
+        m_rejection_threshold(cache.get(m_ab_distance, &computeRejectionThreshold)) {
+        assert(a <= b);
+    }
+
     template <typename Generator>
-    result_type operator()(Generator& g) {
+    constexpr result_type operator()(Generator& g) {
         // All possible values of result_type are valid.
         if (m_ab_distance == 0) {
-            return transposeBack(Catch::Detail::fillBitsFrom<UnsignedIntegerType>(g));
+            return transposeBack(detail::fillBitsFrom<UnsignedIntegerType>(g));
         }
 
-        auto random_number = Catch::Detail::fillBitsFrom<UnsignedIntegerType>(g);
-        auto emul = Catch::Detail::extendedMult(random_number, m_ab_distance);
+        auto random_number = detail::fillBitsFrom<UnsignedIntegerType>(g);
+        auto emul = detail::extendedMult(random_number, m_ab_distance);
         // Unlike Lemire's algorithm we skip the ab_distance check, since
         // we precomputed the rejection threshold, which is always tighter.
         while (emul.lower < m_rejection_threshold) {
-            random_number = Catch::Detail::fillBitsFrom<UnsignedIntegerType>(g);
-            emul = Catch::Detail::extendedMult(random_number, m_ab_distance);
+            random_number = detail::fillBitsFrom<UnsignedIntegerType>(g);
+            emul = detail::extendedMult(random_number, m_ab_distance);
         }
 
         return transposeBack(m_a + emul.upper);
     }
+
+    // Fills [first, last) with numbers from the distribution, see
+    // detail::generateWithDeferredRejection for how it differs from calling
+    // operator() repeatedly.
+    //
+    // For 32 and 64 bit types, the results are the same as calling
+    // operator() repeatedly, and the accept/reject step is vectorized
+    // when possible.
+    template <typename RandomIt, typename Generator>
+    void generate(RandomIt first, RandomIt last, Generator& g) {
+        if (m_ab_distance == 0) {
+            for (; first != last; ++first) {
+                *first = transposeBack(detail::fillBitsFrom<UnsignedIntegerType>(g));
+            }
+            return;
+        }
+        if constexpr (sizeof(UnsignedIntegerType) >= sizeof(std::uint32_t)) {
+            // Filtering a block of random numbers only pays off if the
+            // generator can fill the block quickly, or if enough numbers
+            // get rejected that the retry loop in operator() mispredicts
+            // often. Otherwise the generator is the bottleneck, and
+            // operator() hides the multiplication behind its latency.
+            if (detail::has_fill<Generator>::value ||
+                m_rejection_threshold > detail::frequent_rejection_threshold<UnsignedIntegerType>) {
+                generateFiltered(first, last, g);
+            } else {
+                for (; first != last; ++first) {
+                    *first = (*this)(g);
+                }
+            }
+            return;
+        }
+        detail::generateWithDeferredRejection(first, last, g, [this](Generator& gen) {
+            const auto emul = detail::extendedMult(detail::fillBitsFrom<UnsignedIntegerType>(gen), m_ab_distance);
+            return detail::BulkCandidate<IntegerType>{ transposeBack(m_a + emul.upper),
+                                                       emul.lower < m_rejection_threshold };
+        });
+    }
+
+    void save(checkpoint_writer& out) const {
+        out.write(m_a);
+        out.write(m_ab_distance);
+        out.write(m_rejection_threshold);
+    }
+    void restore(checkpoint_reader& in) {
+        const auto a = in.read<UnsignedIntegerType>();
+        const auto ab_distance = in.read<UnsignedIntegerType>();
+        const auto rejection_threshold = in.read<UnsignedIntegerType>();
+        m_a = a;
+        m_ab_distance = ab_distance;
+        m_rejection_threshold = rejection_threshold;
+    }
+
+private:
+    static constexpr std::size_t bulk_chunk_size = 256;
+
+    // Draws as many random numbers as there are outputs left, filters out
+    // the rejected ones, and repeats until the output is full. This never
+    // draws more numbers than operator() would.
+    template <typename RandomIt, typename Generator>
+    void generateFiltered(RandomIt first, RandomIt last, Generator& g) {
+        UnsignedIntegerType bits[bulk_chunk_size];
+        UnsignedIntegerType accepted[bulk_chunk_size];
+        while (first != last) {
+            const auto wanted = std::min(bulk_chunk_size, static_cast<std::size_t>(last - first));
+            detail::drawBits(bits, wanted, g);
+            // Unsigned outputs can be written in place, without the extra
+            // copy, unless the results need to be transposed back
+            if constexpr (std::is_unsigned<IntegerType>::value &&
+                          std::is_same<RandomIt, UnsignedIntegerType*>::value) {
+                first += filter(bits, wanted, first);
+            } else {
+                const auto count = filter(bits, wanted, accepted);
+                for (std::size_t i = 0; i < count; ++i, ++first) {
+                    *first = transposeBack(accepted[i]);
+                }
+            }
+        }
+    }
+
+    std::size_t filter(const UnsignedIntegerType* bits, std::size_t count, UnsignedIntegerType* out) const {
+        // unsigned long long is a different type from std::uint64_t on
+        // some platforms, so the kernels are picked by size
+        if constexpr (sizeof(UnsignedIntegerType) == sizeof(std::uint32_t)) {
+            return detail::lemireFilter32(bits, count, m_a, m_ab_distance, m_rejection_threshold, out);
+        } else {
+            return detail::lemireFilter64(bits, count, m_a, m_ab_distance, m_rejection_threshold, out);
+        }
+    }
+
 };
 
 // modified variant of lemire_algorithm_reuse
@@ -140,7 +401,7 @@ class lemire_algorithm_lazy_reuse {
 
     static UnsignedIntegerType computeRejectionThreshold(UnsignedIntegerType ab_distance) {
         if (ab_distance == 0) { return 0; }
-        return (~ab_distance + 1) % ab_distance;
+        return division_threshold::compute(ab_distance);
     }
 
     static UnsignedIntegerType transposeTo(IntegerType in) {
@@ -183,32 +444,295 @@ public:
 
         return transposeBack(m_a + emul.upper);
     }
+
+    // Fills [first, last) with numbers from the distribution, see
+    // detail::generateWithDeferredRejection for how it differs from calling
+    // operator() repeatedly.
+    template <typename RandomIt, typename Generator>
+    void generate(RandomIt first, RandomIt last, Generator& g) {
+        if (m_ab_distance == 0) {
+            for (; first != last; ++first) {
+                *first = transposeBack(Catch::Detail::fillBitsFrom<UnsignedIntegerType>(g));
+            }
+            return;
+        }
+        // For a whole range, the threshold will almost certainly be needed
+        if (m_rejection_threshold == NONE) {
+            m_rejection_threshold = computeRejectionThreshold(m_ab_distance);
+        }
+        detail::generateWithDeferredRejection(first, last, g, [this](Generator& gen) {
+            const auto emul = Catch::Detail::extendedMult(
+                Catch::Detail::fillBitsFrom<UnsignedIntegerType>(gen), m_ab_distance);
+            return detail::BulkCandidate<IntegerType>{ transposeBack(m_a + emul.upper),
+                                                       emul.lower < m_rejection_threshold };
+        });
+    }
+
+    // The threshold is saved even if it was not computed yet, as NONE
+    void save(checkpoint_writer& out) const {
+        out.write(m_a);
+        out.write(m_ab_distance);
+        out.write(m_rejection_threshold);
+    }
+    void restore(checkpoint_reader& in) {
+        const auto a = in.read<UnsignedIntegerType>();
+        const auto ab_distance = in.read<UnsignedIntegerType>();
+        const auto rejection_threshold = in.read<UnsignedIntegerType>();
+        m_a = a;
+        m_ab_distance = ab_distance;
+        m_rejection_threshold = rejection_threshold;
+    }
 };
 
 
-// Takes the multiplication implementation through template
-template <typename MultImplementation>
+// Draws several numbers from a single 64 bit random number, see
+// detail::drawBatch. With a distance of 100, one 64 bit random number
+// gives 9 numbers. The numbers from a batch are handed out one by one,
+// so the generator is only called once per batch.
+template <typename IntegerType>
+class lemire_batched {
+    static_assert(std::is_integral<IntegerType>::value, "...");
+
+    using UnsignedIntegerType = Catch::Detail::make_unsigned_t<IntegerType>;
+    static constexpr std::size_t max_batch_size = 16;
+
+    UnsignedIntegerType m_a;
+    // Only 0 if IntegerType is 64 bits wide and the distribution covers all of it
+    std::uint64_t m_ab_distance;
+    // Threshold for m_ab_distance ^ m_batch_size
+    std::uint64_t m_rejection_threshold;
+    std::size_t m_batch_size;
+    std::size_t m_next;
+    std::uint64_t m_batch[max_batch_size];
+
+    static std::uint64_t computeDistance(IntegerType a, IntegerType b) {
+        return std::uint64_t(transposeTo(b)) - transposeTo(a) + 1;
+    }
+
+    static UnsignedIntegerType transposeTo(IntegerType in) {
+        return Catch::Detail::transposeToNaturalOrder<IntegerType>(
+            static_cast<UnsignedIntegerType>(in));
+    }
+    static IntegerType transposeBack(UnsignedIntegerType in) {
+        return static_cast<IntegerType>(
+            Catch::Detail::transposeToNaturalOrder<IntegerType>(in));
+    }
+
+    void computeBatch() {
+        m_batch_size = 1;
+        m_rejection_threshold = 0;
+        if (m_ab_distance == 0) { return; }
+        const auto shape = detail::batchShapeFor(m_ab_distance, max_batch_size);
+        m_batch_size = shape.size;
+        m_rejection_threshold = shape.rejection_threshold;
+    }
+
+    template <typename Generator>
+    void refill(Generator& g) {
+        const auto bound_at = [this](std::size_t) { return m_ab_distance; };
+        auto leftover = detail::drawBatch(g, m_batch_size, bound_at, m_batch);
+        while (leftover < m_rejection_threshold) {
+            leftover = detail::drawBatch(g, m_batch_size, bound_at, m_batch);
+        }
+        m_next = 0;
+    }
+
+public:
+    using result_type = IntegerType;
+
+    lemire_batched(IntegerType a, IntegerType b) :
+        m_a(transposeTo(a)),
+        m_ab_distance(computeDistance(a, b)) {
+        assert(a <= b);
+        computeBatch();
+        m_next = m_batch_size;
+    }
+
+    template <typename Generator>
+    result_type operator()(Generator& g) {
+        // All possible values of result_type are valid.
+        if (m_ab_distance == 0) {
+            return transposeBack(Catch::Detail::fillBitsFrom<UnsignedIntegerType>(g));
+        }
+        if (m_next == m_batch_size) {
+            refill(g);
+        }
+        return transposeBack(static_cast<UnsignedIntegerType>(m_a + m_batch[m_next++]));
+    }
+
+    // Fills [first, last) with numbers from the distribution, the same
+    // as calling operator() repeatedly.
+    template <typename RandomIt, typename Generator>
+    void generate(RandomIt first, RandomIt last, Generator& g) {
+        for (; first != last; ++first) {
+            *first = (*this)(g);
+        }
+    }
+
+    // The unused part of the current batch is saved as well
+    void save(checkpoint_writer& out) const {
+        out.write(m_a);
+        out.write(m_ab_distance);
+        out.write(m_next);
+        for (std::size_t i = m_next; i < m_batch_size; ++i) {
+            out.write(m_batch[i]);
+        }
+    }
+    // The batch is read into a copy, so that a bad checkpoint leaves
+    // this distribution unchanged
+    void restore(checkpoint_reader& in) {
+        auto restored = *this;
+        restored.m_a = in.read<UnsignedIntegerType>();
+        restored.m_ab_distance = in.read<std::uint64_t>();
+        restored.computeBatch();
+        restored.m_next = in.read<std::size_t>();
+        if (restored.m_next > restored.m_batch_size) {
+            throw std::runtime_error("Checkpoint does not match the distribution");
+        }
+        for (std::size_t i = restored.m_next; i < restored.m_batch_size; ++i) {
+            restored.m_batch[i] = in.read<std::uint64_t>();
+        }
+        *this = restored;
+    }
+};
+
+// Fisher-Yates shuffle that draws the indices for several steps from
+// a single 64 bit random number, see detail::drawBatch.
+template <typename RandomIt, typename Generator>
+void batched_shuffle(RandomIt first, RandomIt last, Generator& g) {
+    std::uint64_t indices[6];
+    auto remaining = static_cast<std::uint64_t>(last - first);
+    while (remaining > 1) {
+        // The product of `batch_size` bounds, starting at `remaining` and
+        // going down, must fit into 64 bits
+        std::size_t batch_size = remaining <= (1u << 10)   ? 6
+                                 : remaining <= (1u << 16) ? 4
+                                 : remaining <= (1u << 21) ? 3
+                                 : remaining <= (std::uint64_t(1) << 32) ? 2
+                                                                         : 1;
+        batch_size = static_cast<std::size_t>(std::min<std::uint64_t>(batch_size, remaining - 1));
+
+        std::uint64_t product = 1;
+        for (std::size_t i = 0; i < batch_size; ++i) {
+            product *= remaining - i;
+        }
+        const auto bound_at = [remaining](std::size_t i) { return remaining - i; };
+        auto leftover = detail::drawBatch(g, batch_size, bound_at, indices);
+        // Computing the threshold needs a division, but it can only
+        // reject numbers below the product
+        if (leftover < product) {
+            const auto rejection_threshold = (~product + 1) % product;
+            while (leftover < rejection_threshold) {
+                leftover = detail::drawBatch(g, batch_size, bound_at, indices);
+            }
+        }
+
+        for (std::size_t i = 0; i < batch_size; ++i) {
+            std::iter_swap(first + (remaining - 1 - i), first + indices[i]);
+        }
+        remaining -= batch_size;
+    }
+}
+
+// lemire_algorithm_reuse with the upper bound known at compile time, so
+// that the compiler can fold the threshold and the multiplication. Returns
+// numbers in [0, Bound], the same numbers as lemire_algorithm_reuse(0, Bound),
+// except that Bound = 0 does not use up any random numbers.
+//
+// If the distance is a power of two, there is nothing to reject and the
+// result is just the top bits of the random number.
+template <typename UnsignedIntegerType, UnsignedIntegerType Bound>
+class lemire_fixed {
+    static_assert(std::is_unsigned<UnsignedIntegerType>::value, "...");
+
+    static constexpr UnsignedIntegerType distance = Bound + 1;
+    static constexpr UnsignedIntegerType rejection_threshold =
+        distance == 0 ? 0 : division_threshold::compute(distance);
+    static constexpr bool is_power_of_two = (distance & (distance - 1)) == 0;
+
+public:
+    using result_type = UnsignedIntegerType;
+
+    constexpr lemire_fixed() = default;
+
+    template <typename Generator>
+    constexpr result_type operator()(Generator& g) const {
+        if constexpr (distance == 0) {
+            // All possible values of result_type are valid.
+            return detail::fillBitsFrom<UnsignedIntegerType>(g);
+        } else if constexpr (distance == 1) {
+            return 0;
+        } else if constexpr (is_power_of_two) {
+            constexpr int shift = sizeof(UnsignedIntegerType) * CHAR_BIT - detail::floorLog2(distance);
+            return detail::fillBitsFrom<UnsignedIntegerType>(g) >> shift;
+        } else {
+            auto emul = detail::extendedMult(detail::fillBitsFrom<UnsignedIntegerType>(g), distance);
+            while (emul.lower < rejection_threshold) {
+                emul = detail::extendedMult(detail::fillBitsFrom<UnsignedIntegerType>(g), distance);
+            }
+            return emul.upper;
+        }
+    }
+
+    // Fills [first, last) with numbers from the distribution, the same
+    // as calling operator() repeatedly.
+    template <typename RandomIt, typename Generator>
+    void generate(RandomIt first, RandomIt last, Generator& g) const {
+        for (; first != last; ++first) {
+            *first = (*this)(g);
+        }
+    }
+
+    // There is no state, these only exist so that generic code can
+    // checkpoint any distribution.
+    void save(checkpoint_writer&) const {}
+    void restore(checkpoint_reader&) {}
+};
+
+// Takes the multiplication implementation through template. It is only
+// used for 64 bit types, see detail::templatedMult. The rejection threshold
+// is computed by ThresholdPolicy, which looks small distances up in a table
+// by default.
+template <typename MultImplementation, typename IntegerType = std::uint64_t,
+          typename ThresholdPolicy = small_table_threshold<>>
 class lemire_plain_templated_mult {
-    uint64_t m_a, m_b;
+    static_assert(std::is_integral<IntegerType>::value, "...");
 
-    uint64_t computeDistance(uint64_t a, uint64_t b) const {
-        return b - a + 1;
+    using UnsignedIntegerType = Catch::Detail::make_unsigned_t<IntegerType>;
+
+    UnsignedIntegerType m_a, m_b;
+
+    UnsignedIntegerType computeDistance(UnsignedIntegerType a, UnsignedIntegerType b) const {
+        return static_cast<UnsignedIntegerType>(b - a + 1);
     }
 
-    static uint64_t computeRejectionThreshold(uint64_t ab_distance) {
-        return (~ab_distance + 1) % ab_distance;
+    static UnsignedIntegerType computeRejectionThreshold(UnsignedIntegerType ab_distance) {
+        return ThresholdPolicy::compute(ab_distance);
+    }
+
+    static UnsignedIntegerType transposeTo(IntegerType in) {
+        return Catch::Detail::transposeToNaturalOrder<IntegerType>(
+            static_cast<UnsignedIntegerType>(in));
+    }
+    static IntegerType transposeBack(UnsignedIntegerType in) {
+        return static_cast<IntegerType>(
+            Catch::Detail::transposeToNaturalOrder<IntegerType>(in));
     }
 
     template <typename Generator>
-    uint64_t drawNumber(Generator& g) {
-        return Catch::Detail::fillBitsFrom<uint64_t>(g);
+    UnsignedIntegerType drawNumber(Generator& g) {
+        return Catch::Detail::fillBitsFrom<UnsignedIntegerType>(g);
+    }
+
+    static detail::ExtendedMultResult<UnsignedIntegerType> mult(UnsignedIntegerType lhs, UnsignedIntegerType rhs) {
+        return detail::templatedMult<MultImplementation>(lhs, rhs);
     }
 
 public:
-    using result_type = uint64_t;
+    using result_type = IntegerType;
 
-    lemire_plain_templated_mult(uint64_t a, uint64_t b) :
-        m_a(a), m_b(b) {
+    lemire_plain_templated_mult(IntegerType a, IntegerType b) :
+        m_a(transposeTo(a)), m_b(transposeTo(b)) {
         assert(a <= b);
     }
 
@@ -217,34 +741,167 @@ public:
         auto ab_distance = computeDistance(m_a, m_b);
         // All possible values of result_type are valid.
         if (ab_distance == 0) {
-            return drawNumber(g);
+            return transposeBack(drawNumber(g));
         }
 
         auto random_number = drawNumber(g);
-        auto emul = MultImplementation::Mult(random_number, ab_distance);
+        auto emul = mult(random_number, ab_distance);
         if (emul.lower < ab_distance) {
             auto rejection_threshold = computeRejectionThreshold(ab_distance);
             while (emul.lower < rejection_threshold) {
                 random_number = drawNumber(g);
-                emul = MultImplementation::Mult(random_number, ab_distance);
+                emul = mult(random_number, ab_distance);
             }
         }
 
-        return m_a + emul.upper;
+        return transposeBack(static_cast<UnsignedIntegerType>(m_a + emul.upper));
+    }
+
+    // Fills [first, last) with numbers from the distribution, see
+    // detail::generateWithDeferredRejection for how it differs from calling
+    // operator() repeatedly.
+    template <typename RandomIt, typename Generator>
+    void generate(RandomIt first, RandomIt last, Generator& g) {
+        const auto ab_distance = computeDistance(m_a, m_b);
+        if (ab_distance == 0) {
+            for (; first != last; ++first) {
+                *first = transposeBack(drawNumber(g));
+            }
+            return;
+        }
+        // For a whole range, computing the threshold up front is cheaper than
+        // checking whether we need it for every number.
+        const auto rejection_threshold = computeRejectionThreshold(ab_distance);
+        detail::generateWithDeferredRejection(first, last, g, [&](Generator& gen) {
+            const auto emul = mult(drawNumber(gen), ab_distance);
+            return detail::BulkCandidate<IntegerType>{ transposeBack(static_cast<UnsignedIntegerType>(m_a + emul.upper)),
+                                                       emul.lower < rejection_threshold };
+        });
+    }
+
+    void save(checkpoint_writer& out) const {
+        out.write(m_a);
+        out.write(m_b);
+    }
+    void restore(checkpoint_reader& in) {
+        const auto a = in.read<UnsignedIntegerType>();
+        const auto b = in.read<UnsignedIntegerType>();
+        m_a = a;
+        m_b = b;
     }
 };
 
-// Takes the multiplication implementation through template
-template <typename MultImplementation>
+// Takes the multiplication implementation through template. It is only
+// used for 64 bit types, see detail::templatedMult.
+template <typename MultImplementation, typename IntegerType = std::uint64_t>
 class lemire_reuse_templated_mult {
-    uint64_t m_a, m_ab_distance, m_threshold;
+    static_assert(std::is_integral<IntegerType>::value, "...");
 
-    uint64_t computeDistance(uint64_t a, uint64_t b) const {
-        return b - a + 1;
+    using UnsignedIntegerType = Catch::Detail::make_unsigned_t<IntegerType>;
+
+    UnsignedIntegerType m_a, m_ab_distance, m_threshold;
+
+    UnsignedIntegerType computeDistance(UnsignedIntegerType a, UnsignedIntegerType b) const {
+        return static_cast<UnsignedIntegerType>(b - a + 1);
+    }
+
+    static UnsignedIntegerType computeRejectionThreshold(UnsignedIntegerType ab_distance) {
+        if (ab_distance == 0) { return 0; }
+        return division_threshold::compute(ab_distance);
+    }
+
+    static UnsignedIntegerType transposeTo(IntegerType in) {
+        return Catch::Detail::transposeToNaturalOrder<IntegerType>(
+            static_cast<UnsignedIntegerType>(in));
+    }
+    static IntegerType transposeBack(UnsignedIntegerType in) {
+        return static_cast<IntegerType>(
+            Catch::Detail::transposeToNaturalOrder<IntegerType>(in));
+    }
+
+    template <typename Generator>
+    UnsignedIntegerType drawNumber(Generator& g) {
+        return Catch::Detail::fillBitsFrom<UnsignedIntegerType>(g);
+    }
+
+    static detail::ExtendedMultResult<UnsignedIntegerType> mult(UnsignedIntegerType lhs, UnsignedIntegerType rhs) {
+        return detail::templatedMult<MultImplementation>(lhs, rhs);
+    }
+
+public:
+    using result_type = IntegerType;
+
+    lemire_reuse_templated_mult(IntegerType a, IntegerType b) :
+        m_a(transposeTo(a)),
+        m_ab_distance(computeDistance(m_a, transposeTo(b))),
+        m_threshold(computeRejectionThreshold(m_ab_distance)) {
+        assert(a <= b);
+    }
+
+    template <typename Generator>
+    result_type operator()(Generator& g) {
+        // All possible values of result_type are valid.
+        if (m_ab_distance == 0) {
+            return transposeBack(drawNumber(g));
+        }
+
+        auto random_number = drawNumber(g);
+        auto emul = mult(random_number, m_ab_distance);
+        while (emul.lower < m_threshold) {
+            random_number = drawNumber(g);
+            emul = mult(random_number, m_ab_distance);
+        }
+
+        return transposeBack(static_cast<UnsignedIntegerType>(m_a + emul.upper));
+    }
+
+    // Fills [first, last) with numbers from the distribution, see
+    // detail::generateWithDeferredRejection for how it differs from calling
+    // operator() repeatedly.
+    template <typename RandomIt, typename Generator>
+    void generate(RandomIt first, RandomIt last, Generator& g) {
+        if (m_ab_distance == 0) {
+            for (; first != last; ++first) {
+                *first = transposeBack(drawNumber(g));
+            }
+            return;
+        }
+        detail::generateWithDeferredRejection(first, last, g, [this](Generator& gen) {
+            const auto emul = mult(drawNumber(gen), m_ab_distance);
+            return detail::BulkCandidate<IntegerType>{ transposeBack(static_cast<UnsignedIntegerType>(m_a + emul.upper)),
+                                                       emul.lower < m_threshold };
+        });
     }
 
-    static uint64_t computeRejectionThreshold(uint64_t ab_distance) {
-        return (~ab_distance + 1) % ab_distance;
+    void save(checkpoint_writer& out) const {
+        out.write(m_a);
+        out.write(m_ab_distance);
+        out.write(m_threshold);
+    }
+    void restore(checkpoint_reader& in) {
+        const auto a = in.read<UnsignedIntegerType>();
+        const auto ab_distance = in.read<UnsignedIntegerType>();
+        const auto threshold = in.read<UnsignedIntegerType>();
+        m_a = a;
+        m_ab_distance = ab_distance;
+        m_threshold = threshold;
+    }
+};
+
+// Stephen Canon's variant of Lemire's algorithm. Instead of rejecting
+// the numbers that would cause bias, it multiplies a second random number
+// by the distance, and adds the upper half of that product to the lower
+// half of the first one. If that carries, the result goes up by one.
+//
+// This needs neither a rejection threshold, nor a loop, and calls the
+// generator at most twice per number. The price is that the result is
+// not exactly uniform, but the bias is at most distance / 2^128.
+template <typename MultImplementation>
+class lemire_canon_templated_mult {
+    uint64_t m_a, m_ab_distance;
+
+    uint64_t computeDistance(uint64_t a, uint64_t b) const {
+        return b - a + 1;
     }
 
     template <typename Generator>
@@ -255,8 +912,8 @@ class lemire_reuse_templated_mult {
 public:
     using result_type = uint64_t;
 
-    lemire_reuse_templated_mult(uint64_t a, uint64_t b) :
-        m_a(a), m_ab_distance(computeDistance(a, b)), m_threshold(computeRejectionThreshold(m_ab_distance)) {
+    lemire_canon_templated_mult(uint64_t a, uint64_t b) :
+        m_a(a), m_ab_distance(computeDistance(a, b)) {
         assert(a <= b);
     }
 
@@ -267,13 +924,289 @@ public:
             return drawNumber(g);
         }
 
-        auto random_number = drawNumber(g);
-        auto emul = MultImplementation::Mult(random_number, m_ab_distance);
+        auto emul = MultImplementation::Mult(drawNumber(g), m_ab_distance);
+        // Adding something below the distance can only carry if the
+        // lower half is above 2^64 - distance.
+        if (emul.lower > ~m_ab_distance + 1) {
+            const auto extra = MultImplementation::Mult(drawNumber(g), m_ab_distance);
+            emul.upper += (emul.lower + extra.upper) < emul.lower;
+        }
+
+        return m_a + emul.upper;
+    }
+
+    // Fills [first, last) with numbers from the distribution, the same
+    // as calling operator() repeatedly.
+    template <typename RandomIt, typename Generator>
+    void generate(RandomIt first, RandomIt last, Generator& g) {
+        for (; first != last; ++first) {
+            *first = (*this)(g);
+        }
+    }
+
+    void save(checkpoint_writer& out) const {
+        out.write(m_a);
+        out.write(m_ab_distance);
+    }
+    void restore(checkpoint_reader& in) {
+        const auto a = in.read<uint64_t>();
+        const auto ab_distance = in.read<uint64_t>();
+        m_a = a;
+        m_ab_distance = ab_distance;
+    }
+};
+
+// The distances at which lemire_adaptive switches between its kernels.
+// To tune them for a different machine or generator, pass a struct with
+// the same members to lemire_adaptive.
+struct lemire_adaptive_thresholds {
+    // Distances up to this are drawn in batches. A batch needs at least
+    // 3 numbers to beat drawing them one by one with a 64 bit generator.
+    static constexpr std::uint64_t max_batched_distance = std::uint64_t(1) << 21;
+    // Distances whose rejection threshold is at least this use Canon's
+    // rejection-free variant, because Lemire's method would have to redraw
+    // 1 in 16 numbers or more. UINT64_MAX disables it, as the threshold is
+    // always below that, which keeps the results exactly uniform.
+    static constexpr std::uint64_t min_rejection_free_threshold = std::uint64_t(1) << 60;
+};
+
+// Checks the distance once, when constructed, and then uses whichever
+// of the variants above is the fastest for it:
+//  * lemire_batched for small distances
+//  * the top bits of the random number for powers of two
+//  * lemire_canon_templated_mult if Lemire's method would reject often
+//  * lemire_reuse_templated_mult for everything else
+// and returns the same numbers as that variant would.
+template <typename Thresholds = lemire_adaptive_thresholds>
+class lemire_adaptive {
+    enum class kernel : unsigned char { full_range, batched, mask, lemire, rejection_free };
+
+    static constexpr std::size_t max_batch_size = 16;
+
+    std::uint64_t m_a;
+    // Only 0 if the distribution covers all of uint64_t
+    std::uint64_t m_ab_distance;
+    // For the batched kernel, this is the threshold for the whole batch
+    std::uint64_t m_rejection_threshold;
+    kernel m_kernel;
+    int m_shift;
+    std::size_t m_batch_size;
+    std::size_t m_next;
+    std::uint64_t m_batch[max_batch_size];
+
+    void pickKernel() {
+        m_rejection_threshold = 0;
+        m_shift = 0;
+        m_batch_size = 0;
+        if (m_ab_distance == 0) {
+            m_kernel = kernel::full_range;
+        } else if (m_ab_distance <= Thresholds::max_batched_distance) {
+            m_kernel = kernel::batched;
+            const auto shape = detail::batchShapeFor(m_ab_distance, max_batch_size);
+            m_batch_size = shape.size;
+            m_rejection_threshold = shape.rejection_threshold;
+        } else if (m_ab_distance > 1 && (m_ab_distance & (m_ab_distance - 1)) == 0) {
+            m_kernel = kernel::mask;
+            m_shift = 64 - detail::floorLog2(m_ab_distance);
+        } else {
+            m_rejection_threshold = (~m_ab_distance + 1) % m_ab_distance;
+            m_kernel = m_rejection_threshold >= Thresholds::min_rejection_free_threshold ? kernel::rejection_free
+                                                                                         : kernel::lemire;
+        }
+        m_next = m_batch_size;
+    }
+
+    template <typename Generator>
+    std::uint64_t drawNumber(Generator& g) {
+        return detail::fillBitsFrom<std::uint64_t>(g);
+    }
+
+    template <typename Generator>
+    void refill(Generator& g) {
+        const auto bound_at = [this](std::size_t) { return m_ab_distance; };
+        auto leftover = detail::drawBatch(g, m_batch_size, bound_at, m_batch);
+        while (leftover < m_rejection_threshold) {
+            leftover = detail::drawBatch(g, m_batch_size, bound_at, m_batch);
+        }
+        m_next = 0;
+    }
+
+    template <typename Generator>
+    std::uint64_t drawBatched(Generator& g) {
+        if (m_next == m_batch_size) {
+            refill(g);
+        }
+        return m_a + m_batch[m_next++];
+    }
+
+    template <typename Generator>
+    std::uint64_t drawMasked(Generator& g) {
+        return m_a + (drawNumber(g) >> m_shift);
+    }
+
+    template <typename Generator>
+    std::uint64_t drawLemire(Generator& g) {
+        auto emul = detail::extendedMult(drawNumber(g), m_ab_distance);
+        while (emul.lower < m_rejection_threshold) {
+            emul = detail::extendedMult(drawNumber(g), m_ab_distance);
+        }
+        return m_a + emul.upper;
+    }
+
+    template <typename Generator>
+    std::uint64_t drawRejectionFree(Generator& g) {
+        auto emul = detail::extendedMult(drawNumber(g), m_ab_distance);
+        if (emul.lower > ~m_ab_distance + 1) {
+            const auto extra = detail::extendedMult(drawNumber(g), m_ab_distance);
+            emul.upper += (emul.lower + extra.upper) < emul.lower;
+        }
+        return m_a + emul.upper;
+    }
+
+public:
+    using result_type = std::uint64_t;
+
+    lemire_adaptive(std::uint64_t a, std::uint64_t b) :
+        m_a(a), m_ab_distance(b - a + 1) {
+        assert(a <= b);
+        pickKernel();
+    }
+
+    template <typename Generator>
+    result_type operator()(Generator& g) {
+        // The kernel is only looked at once the batch is empty, which it
+        // always is for the other kernels, so that small distances get to
+        // their numbers as fast as in lemire_batched. Serving the batch from
+        // a single place, after the refill, matters for that as well.
+        if (m_next == m_batch_size) {
+            // The branches are predictable, and unlike a jump table, they
+            // let the common kernel get to its number with a single comparison.
+            if (m_kernel == kernel::batched) {
+                refill(g);
+            } else if (m_kernel == kernel::lemire) {
+                return drawLemire(g);
+            } else if (m_kernel == kernel::rejection_free) {
+                return drawRejectionFree(g);
+            } else if (m_kernel == kernel::mask) {
+                return drawMasked(g);
+            } else {
+                // All possible values of result_type are valid.
+                return drawNumber(g);
+            }
+        }
+        return m_a + m_batch[m_next++];
+    }
+
+    // Fills [first, last) with numbers from the distribution, the same
+    // as calling operator() repeatedly, but only dispatches once.
+    template <typename RandomIt, typename Generator>
+    void generate(RandomIt first, RandomIt last, Generator& g) {
+        const auto fill = [&](auto draw) {
+            for (; first != last; ++first) {
+                *first = draw();
+            }
+        };
+        switch (m_kernel) {
+        case kernel::batched: return fill([&] { return drawBatched(g); });
+        case kernel::mask: return fill([&] { return drawMasked(g); });
+        case kernel::lemire: return fill([&] { return drawLemire(g); });
+        case kernel::rejection_free: return fill([&] { return drawRejectionFree(g); });
+        case kernel::full_range: break;
+        }
+        fill([&] { return drawNumber(g); });
+    }
+
+    // The kernel is picked again on restore, only the unused part
+    // of the current batch is saved with the bounds
+    void save(checkpoint_writer& out) const {
+        out.write(m_a);
+        out.write(m_ab_distance);
+        out.write(m_next);
+        for (std::size_t i = m_next; i < m_batch_size; ++i) {
+            out.write(m_batch[i]);
+        }
+    }
+    // The batch is read into a copy, so that a bad checkpoint leaves
+    // this distribution unchanged
+    void restore(checkpoint_reader& in) {
+        auto restored = *this;
+        restored.m_a = in.read<std::uint64_t>();
+        restored.m_ab_distance = in.read<std::uint64_t>();
+        restored.pickKernel();
+        restored.m_next = in.read<std::size_t>();
+        if (restored.m_next > restored.m_batch_size) {
+            throw std::runtime_error("Checkpoint does not match the distribution");
+        }
+        for (std::size_t i = restored.m_next; i < restored.m_batch_size; ++i) {
+            restored.m_batch[i] = in.read<std::uint64_t>();
+        }
+        *this = restored;
+    }
+};
+
+#if defined( USE_UINT128 )
+// lemire_reuse_templated_mult for 128 bit numbers, the multiplication
+// implementation must return an ext_mul128_result. Every random number
+// is put together from two 64 bit ones, the first one is the upper half.
+template <typename MultImplementation>
+class lemire_uint128_templated_mult {
+    __uint128_t m_a, m_ab_distance, m_threshold;
+
+    static __uint128_t computeRejectionThreshold(__uint128_t ab_distance) {
+        return ab_distance == 0 ? 0 : (~ab_distance + 1) % ab_distance;
+    }
+
+    template <typename Generator>
+    __uint128_t drawNumber(Generator& g) {
+        const auto upper = detail::fillBitsFrom<std::uint64_t>(g);
+        const auto lower = detail::fillBitsFrom<std::uint64_t>(g);
+        return (__uint128_t(upper) << 64) | lower;
+    }
+
+public:
+    using result_type = __uint128_t;
+
+    lemire_uint128_templated_mult(__uint128_t a, __uint128_t b) :
+        m_a(a), m_ab_distance(b - a + 1), m_threshold(computeRejectionThreshold(m_ab_distance)) {
+        assert(a <= b);
+    }
+
+    template <typename Generator>
+    result_type operator()(Generator& g) {
+        // All possible values of result_type are valid.
+        if (m_ab_distance == 0) {
+            return drawNumber(g);
+        }
+
+        auto emul = MultImplementation::Mult(drawNumber(g), m_ab_distance);
         while (emul.lower < m_threshold) {
-            random_number = drawNumber(g);
-            emul = MultImplementation::Mult(random_number, m_ab_distance);
+            emul = MultImplementation::Mult(drawNumber(g), m_ab_distance);
         }
 
         return m_a + emul.upper;
     }
+
+    // Fills [first, last) with numbers from the distribution, the same
+    // as calling operator() repeatedly.
+    template <typename RandomIt, typename Generator>
+    void generate(RandomIt first, RandomIt last, Generator& g) {
+        for (; first != last; ++first) {
+            *first = (*this)(g);
+        }
+    }
+
+    void save(checkpoint_writer& out) const {
+        out.write(m_a);
+        out.write(m_ab_distance);
+        out.write(m_threshold);
+    }
+    void restore(checkpoint_reader& in) {
+        const auto a = in.read<__uint128_t>();
+        const auto ab_distance = in.read<__uint128_t>();
+        const auto threshold = in.read<__uint128_t>();
+        m_a = a;
+        m_ab_distance = ab_distance;
+        m_threshold = threshold;
+    }
 };
+#endif
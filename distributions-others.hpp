@@ -1,121 +1,398 @@
 #pragma once
 
+#include <catch2/internal/catch_random_integer_helpers.hpp>
+
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <type_traits>
+#include "bulk-generate.hpp"
+#include "checkpoint.hpp"
+#include "distance-cache.hpp"
+#include "engine-adapters.hpp"
 #include "libdivide.h"
-
+#include "rejection-threshold.hpp"
+
+// The java_* and OpenBSD_* distributions work on the unsigned type of the
+// same width as IntegerType, so that narrow types use narrow divisions, and
+// a 32 bit generator is called just once per 32 bit number. Signed types
+// are moved into unsigned ones by transposeToNaturalOrder, the same as in
+// lemire_algorithm_reuse.
+//
+// The casts around the arithmetic keep 8 and 16 bit types from being
+// promoted to int, which would make the negations negative.
+//
+// IntegerType defaults to std::uint64_t, as for lemire_*_templated_mult.
+
+template <typename IntegerType = std::uint64_t>
 class java_plain {
+	static_assert(std::is_integral<IntegerType>::value, "...");
+
+	using UnsignedIntegerType = Catch::Detail::make_unsigned_t<IntegerType>;
+
 private:
-	std::uint64_t m_a, m_b;
+	UnsignedIntegerType m_a, m_b;
 
 	template <typename Generator>
-	uint64_t drawNumber(Generator& g) {
-		return Catch::Detail::fillBitsFrom<uint64_t>(g);
+	UnsignedIntegerType drawNumber(Generator& g) {
+		return Catch::Detail::fillBitsFrom<UnsignedIntegerType>(g);
+	}
+
+	static UnsignedIntegerType transposeTo(IntegerType in) {
+		return Catch::Detail::transposeToNaturalOrder<IntegerType>(static_cast<UnsignedIntegerType>(in));
+	}
+	static IntegerType transposeBack(UnsignedIntegerType in) {
+		return static_cast<IntegerType>(Catch::Detail::transposeToNaturalOrder<IntegerType>(in));
 	}
 
 public:
-	using result_type = std::uint64_t;
+	using result_type = IntegerType;
 
-	java_plain(std::uint64_t a, std::uint64_t b) :m_a(a), m_b(b) {}
+	java_plain(IntegerType a, IntegerType b) :m_a(transposeTo(a)), m_b(transposeTo(b)) {}
 
 	template <typename Generator>
 	result_type operator()(Generator& g) {
-		const auto distance = m_b - m_a + 1;
+		const auto distance = static_cast<UnsignedIntegerType>(m_b - m_a + 1);
 		if (distance == 0) {
-			return drawNumber(g);
+			return transposeBack(drawNumber(g));
 		}
 		auto x = drawNumber(g);
-		auto r = x % distance;
-		while (x - r > (-distance)) {
+		auto r = static_cast<UnsignedIntegerType>(x % distance);
+		while (static_cast<UnsignedIntegerType>(x - r) > static_cast<UnsignedIntegerType>(-distance)) {
 			x = drawNumber(g);
-			r = x % distance;
+			r = static_cast<UnsignedIntegerType>(x % distance);
+		}
+		return transposeBack(static_cast<UnsignedIntegerType>(m_a + r));
+	}
+
+	// Fills [first, last) with numbers from the distribution, see
+	// detail::generateWithDeferredRejection for how it differs from calling
+	// operator() repeatedly.
+	template <typename RandomIt, typename Generator>
+	void generate(RandomIt first, RandomIt last, Generator& g) {
+		const auto distance = static_cast<UnsignedIntegerType>(m_b - m_a + 1);
+		if (distance == 0) {
+			for (; first != last; ++first) {
+				*first = transposeBack(drawNumber(g));
+			}
+			return;
 		}
-		return m_a + r;
+		const auto limit = static_cast<UnsignedIntegerType>(-distance);
+		detail::generateWithDeferredRejection(first, last, g, [&](Generator& gen) {
+			const auto x = drawNumber(gen);
+			const auto r = static_cast<UnsignedIntegerType>(x % distance);
+			return detail::BulkCandidate<IntegerType>{ transposeBack(static_cast<UnsignedIntegerType>(m_a + r)),
+			                                           static_cast<UnsignedIntegerType>(x - r) > limit };
+		});
+	}
+
+	void save(checkpoint_writer& out) const {
+		out.write(m_a);
+		out.write(m_b);
+	}
+	void restore(checkpoint_reader& in) {
+		const auto a = in.read<UnsignedIntegerType>();
+		const auto b = in.read<UnsignedIntegerType>();
+		m_a = a;
+		m_b = b;
 	}
 };
 
+template <typename IntegerType = std::uint64_t>
 class java_reuse {
+	static_assert(std::is_integral<IntegerType>::value, "...");
+
+	using UnsignedIntegerType = Catch::Detail::make_unsigned_t<IntegerType>;
+
 private:
-	std::uint64_t m_a, m_distance;
+	UnsignedIntegerType m_a, m_distance;
 
 	template <typename Generator>
-	uint64_t drawNumber(Generator& g) {
-		return Catch::Detail::fillBitsFrom<uint64_t>(g);
+	UnsignedIntegerType drawNumber(Generator& g) {
+		return Catch::Detail::fillBitsFrom<UnsignedIntegerType>(g);
+	}
+
+	static UnsignedIntegerType transposeTo(IntegerType in) {
+		return Catch::Detail::transposeToNaturalOrder<IntegerType>(static_cast<UnsignedIntegerType>(in));
+	}
+	static IntegerType transposeBack(UnsignedIntegerType in) {
+		return static_cast<IntegerType>(Catch::Detail::transposeToNaturalOrder<IntegerType>(in));
 	}
 
 public:
-	using result_type = std::uint64_t;
+	using result_type = IntegerType;
 
-	java_reuse(std::uint64_t a, std::uint64_t b) :m_a(a), m_distance(b - m_a + 1) {}
+	java_reuse(IntegerType a, IntegerType b) :
+		m_a(transposeTo(a)), m_distance(static_cast<UnsignedIntegerType>(transposeTo(b) - m_a + 1)) {}
 
 	template <typename Generator>
 	result_type operator()(Generator& g) {
 		if (m_distance == 0) {
-			return drawNumber(g);
+			return transposeBack(drawNumber(g));
 		}
 		auto x = drawNumber(g);
-		auto r = x % m_distance;
-		while (x - r > (-m_distance)) {
+		auto r = static_cast<UnsignedIntegerType>(x % m_distance);
+		while (static_cast<UnsignedIntegerType>(x - r) > static_cast<UnsignedIntegerType>(-m_distance)) {
 			x = drawNumber(g);
-			r = x % m_distance;
+			r = static_cast<UnsignedIntegerType>(x % m_distance);
+		}
+		return transposeBack(static_cast<UnsignedIntegerType>(m_a + r));
+	}
+
+	// Fills [first, last) with numbers from the distribution, see
+	// detail::generateWithDeferredRejection for how it differs from calling
+	// operator() repeatedly.
+	template <typename RandomIt, typename Generator>
+	void generate(RandomIt first, RandomIt last, Generator& g) {
+		const auto distance = m_distance;
+		if (distance == 0) {
+			for (; first != last; ++first) {
+				*first = transposeBack(drawNumber(g));
+			}
+			return;
 		}
-		return m_a + r;
+		const auto limit = static_cast<UnsignedIntegerType>(-distance);
+		detail::generateWithDeferredRejection(first, last, g, [&](Generator& gen) {
+			const auto x = drawNumber(gen);
+			const auto r = static_cast<UnsignedIntegerType>(x % distance);
+			return detail::BulkCandidate<IntegerType>{ transposeBack(static_cast<UnsignedIntegerType>(m_a + r)),
+			                                           static_cast<UnsignedIntegerType>(x - r) > limit };
+		});
+	}
+
+	void save(checkpoint_writer& out) const {
+		out.write(m_a);
+		out.write(m_distance);
+	}
+	void restore(checkpoint_reader& in) {
+		const auto a = in.read<UnsignedIntegerType>();
+		const auto distance = in.read<UnsignedIntegerType>();
+		m_a = a;
+		m_distance = distance;
 	}
 };
 
+namespace detail {
+    // libdivide has no 8 bit dividers, so 8 bit numbers are divided as 16 bit ones
+    template <typename UnsignedIntegerType>
+    using libdivide_operand_t = std::conditional_t<sizeof( UnsignedIntegerType ) == 1, std::uint16_t, UnsignedIntegerType>;
+
+    // libdivide aborts on 0, which is the distance of the full range.
+    // That never gets divided by, so any other divider will do.
+    template <typename UnsignedIntegerType>
+    libdivide::divider<libdivide_operand_t<UnsignedIntegerType>> makeDivider( UnsignedIntegerType distance ) {
+        return libdivide::divider<libdivide_operand_t<UnsignedIntegerType>>( distance == 0 ? 1 : distance );
+    }
+
+    // Picked by size, like remaindersBranchfree
+    template <typename UInt>
+    auto makeBranchfree( UInt distance ) {
+        if constexpr ( sizeof( UInt ) == sizeof( std::uint32_t ) ) {
+            return libdivide::libdivide_u32_branchfree_gen( static_cast<std::uint32_t>( distance ) );
+        } else {
+            return libdivide::libdivide_u64_branchfree_gen( static_cast<std::uint64_t>( distance ) );
+        }
+    }
+
+    // Drawing the bits is the slow part of the bulk path, unless the engine
+    // can fill a whole chunk at once. Otherwise it only pays off when many
+    // draws get rejected, because the rejected ones are divided in bulk too.
+    // `threshold()` returns 2^N % distance, the number of rejected draws,
+    // and is only called when the engine cannot fill.
+    template <typename Generator, typename Threshold>
+    bool bulkRemaindersPayOff( Threshold threshold ) {
+        if constexpr ( has_fill<Generator>::value ) {
+            return true;
+        } else {
+            using UInt = decltype( threshold() );
+            return threshold() > frequent_rejection_threshold<UInt>;
+        }
+    }
+
+    // Does the same as generateWithDeferredRejection, but draws the whole
+    // chunk first, and computes all the remainders at once with libdivide's
+    // branchfree divider, vectorized by remaindersBranchfree. `finish(x, r)`
+    // turns a draw and its remainder into a BulkCandidate. The rejected
+    // slots are redrawn with `attempt` in a second pass, in the same order
+    // as generateWithDeferredRejection, so the results are the same too.
+    //
+    // The branchfree divider cannot divide by 1, so distance must be > 1.
+    template <typename IntegerType, typename UInt, typename RandomIt, typename Generator, typename Finish,
+              typename Attempt>
+    void generateWithBulkRemainders( RandomIt first, RandomIt last, Generator& g, UInt distance, Finish finish,
+                                     Attempt attempt ) {
+        constexpr std::size_t chunk_size = 256;
+        UInt bits[chunk_size];
+        UInt remainders[chunk_size];
+        std::uint32_t rejected_slots[chunk_size];
+        const auto branchfree = makeBranchfree( distance );
+
+        while ( first != last ) {
+            const auto chunk = std::min( chunk_size, static_cast<std::size_t>( last - first ) );
+            drawBits( bits, chunk, g );
+            remaindersBranchfree( bits, chunk, static_cast<UInt>( branchfree.magic ), branchfree.more, distance,
+                                  remainders );
+            std::size_t rejected_count = 0;
+            for ( std::size_t i = 0; i < chunk; ++i ) {
+                const auto candidate = finish( bits[i], remainders[i] );
+                first[i] = candidate.value;
+                rejected_slots[rejected_count] = static_cast<std::uint32_t>( i );
+                rejected_count += candidate.rejected;
+            }
+            for ( std::size_t r = 0; r < rejected_count; ++r ) {
+                auto candidate = attempt( g );
+                while ( candidate.rejected ) {
+                    candidate = attempt( g );
+                }
+                first[rejected_slots[r]] = candidate.value;
+            }
+            first += chunk;
+        }
+    }
+} // namespace detail
+
+template <typename IntegerType = std::uint64_t>
 class java_libdivide {
+    static_assert( std::is_integral<IntegerType>::value, "..." );
+
+    using UnsignedIntegerType = Catch::Detail::make_unsigned_t<IntegerType>;
+    using DivisionType = detail::libdivide_operand_t<UnsignedIntegerType>;
+
 private:
-    std::uint64_t m_a, m_distance;
-    libdivide::divider<std::uint64_t> m_divider;
+    UnsignedIntegerType m_a, m_distance;
+    libdivide::divider<DivisionType> m_divider;
 
     template <typename Generator>
-    uint64_t drawNumber( Generator& g ) {
-        return Catch::Detail::fillBitsFrom<uint64_t>( g );
+    UnsignedIntegerType drawNumber( Generator& g ) {
+        return Catch::Detail::fillBitsFrom<UnsignedIntegerType>( g );
+    }
+
+    static UnsignedIntegerType transposeTo( IntegerType in ) {
+        return Catch::Detail::transposeToNaturalOrder<IntegerType>( static_cast<UnsignedIntegerType>( in ) );
+    }
+    static IntegerType transposeBack( UnsignedIntegerType in ) {
+        return static_cast<IntegerType>( Catch::Detail::transposeToNaturalOrder<IntegerType>( in ) );
     }
 
-	uint64_t takeMod(uint64_t in) {
-        return in - ( in / m_divider ) * m_distance;
+	UnsignedIntegerType takeMod(UnsignedIntegerType in) {
+        return static_cast<UnsignedIntegerType>( in - ( DivisionType( in ) / m_divider ) * m_distance );
 	}
 
 public:
-    using result_type = std::uint64_t;
+    using result_type = IntegerType;
 
-    java_libdivide( std::uint64_t a, std::uint64_t b ):
-        m_a( a ), m_distance( b - m_a + 1 ), m_divider( m_distance ) {}
+    // Dividers cached by distance, see distance-cache.hpp
+    template <std::size_t Slots = 64>
+    using cache_type = distance_cache<UnsignedIntegerType, libdivide::divider<DivisionType>, Slots>;
+
+    java_libdivide( IntegerType a, IntegerType b ):
+        m_a( transposeTo( a ) ),
+        m_distance( static_cast<UnsignedIntegerType>( transposeTo( b ) - m_a + 1 ) ),
+        m_divider( detail::makeDivider( m_distance ) ) {}
+
+    // Takes the divider from `cache`, instead of building a new one
+    template <std::size_t Slots>
+    java_libdivide( IntegerType a, IntegerType b, cache_type<Slots>& cache ):
+        m_a( transposeTo( a ) ),
+        m_distance( static_cast<UnsignedIntegerType>( transposeTo( b ) - m_a + 1 ) ),
+        m_divider( cache.get( m_distance, &detail::makeDivider<UnsignedIntegerType> ) ) {}
 
     template <typename Generator>
     result_type operator()( Generator& g ) {
-        if ( m_distance == 0 ) { return drawNumber( g ); }
+        if ( m_distance == 0 ) { return transposeBack( drawNumber( g ) ); }
         auto x = drawNumber( g );
         auto r = takeMod(x);
-        while ( x - r > ( -m_distance ) ) {
+        while ( static_cast<UnsignedIntegerType>( x - r ) > static_cast<UnsignedIntegerType>( -m_distance ) ) {
             x = drawNumber( g );
             r = takeMod(x);
         }
-        return m_a + r;
+        return transposeBack( static_cast<UnsignedIntegerType>( m_a + r ) );
+    }
+
+    // Fills [first, last) with numbers from the distribution, see
+    // detail::generateWithDeferredRejection for how it differs from calling
+    // operator() repeatedly. For 32 and 64 bit types, the remainders are
+    // computed a chunk at a time when that pays off, see
+    // detail::generateWithBulkRemainders.
+    template <typename RandomIt, typename Generator>
+    void generate( RandomIt first, RandomIt last, Generator& g ) {
+        if ( m_distance == 0 ) {
+            for ( ; first != last; ++first ) {
+                *first = transposeBack( drawNumber( g ) );
+            }
+            return;
+        }
+        const auto limit = static_cast<UnsignedIntegerType>( -m_distance );
+        auto finish = [this, limit]( UnsignedIntegerType x, UnsignedIntegerType r ) {
+            return detail::BulkCandidate<IntegerType>{ transposeBack( static_cast<UnsignedIntegerType>( m_a + r ) ),
+                                                       static_cast<UnsignedIntegerType>( x - r ) > limit };
+        };
+        auto attempt = [this, &finish]( Generator& gen ) {
+            const auto x = drawNumber( gen );
+            return finish( x, takeMod( x ) );
+        };
+        // libdivide has no vector dividers for the narrow types
+        if constexpr ( sizeof( UnsignedIntegerType ) >= sizeof( std::uint32_t ) ) {
+            // Rejects as many draws as OpenBSD_libdivide. The threshold is
+            // (-distance) % distance, taken with the divider rather than a hardware %
+            const auto threshold = [this] { return takeMod( static_cast<UnsignedIntegerType>( -m_distance ) ); };
+            if ( m_distance > 1 && detail::bulkRemaindersPayOff<Generator>( threshold ) ) {
+                detail::generateWithBulkRemainders<IntegerType>( first, last, g, m_distance, finish, attempt );
+                return;
+            }
+        }
+        detail::generateWithDeferredRejection( first, last, g, attempt );
+    }
+
+    // The divider is rebuilt rather than saved, to keep the checkpoint small
+    void save( checkpoint_writer& out ) const {
+        out.write( m_a );
+        out.write( m_distance );
+    }
+    void restore( checkpoint_reader& in ) {
+        const auto a = in.read<UnsignedIntegerType>();
+        const auto distance = in.read<UnsignedIntegerType>();
+        m_a = a;
+        m_distance = distance;
+        m_divider = detail::makeDivider( m_distance );
     }
 };
 
+// The rejection threshold is computed by ThresholdPolicy, see
+// rejection-threshold.hpp.
+template <typename IntegerType = std::uint64_t, typename ThresholdPolicy = division_threshold>
 class OpenBSD_plain {
+	static_assert(std::is_integral<IntegerType>::value, "...");
+
+	using UnsignedIntegerType = Catch::Detail::make_unsigned_t<IntegerType>;
+
 private:
-	std::uint64_t m_a, m_b;
+	UnsignedIntegerType m_a, m_b;
 
 	template <typename Generator>
-	uint64_t drawNumber(Generator& g) {
-		return Catch::Detail::fillBitsFrom<uint64_t>(g);
+	UnsignedIntegerType drawNumber(Generator& g) {
+		return Catch::Detail::fillBitsFrom<UnsignedIntegerType>(g);
+	}
+
+	static UnsignedIntegerType transposeTo(IntegerType in) {
+		return Catch::Detail::transposeToNaturalOrder<IntegerType>(static_cast<UnsignedIntegerType>(in));
+	}
+	static IntegerType transposeBack(UnsignedIntegerType in) {
+		return static_cast<IntegerType>(Catch::Detail::transposeToNaturalOrder<IntegerType>(in));
 	}
 
 public:
-	using result_type = std::uint64_t;
+	using result_type = IntegerType;
 
-	OpenBSD_plain(std::uint64_t a, std::uint64_t b) :m_a(a), m_b(b) {}
+	OpenBSD_plain(IntegerType a, IntegerType b) :m_a(transposeTo(a)), m_b(transposeTo(b)) {}
 
 	template <typename Generator>
 	result_type operator()(Generator& g) {
-		const auto distance = m_b - m_a + 1;
+		const auto distance = static_cast<UnsignedIntegerType>(m_b - m_a + 1);
 		if (distance == 0) {
-			return drawNumber(g);
+			return transposeBack(drawNumber(g));
 		}
-		const auto threshold = (-distance) % distance;
+		const auto threshold = ThresholdPolicy::compute(distance);
 
 		// do while?
 		auto x = drawNumber(g);
@@ -123,28 +400,79 @@ public:
 			x = drawNumber(g);
 		}
 
-		return m_a + (x % distance);
+		return transposeBack(static_cast<UnsignedIntegerType>(m_a + (x % distance)));
+	}
+
+	// Fills [first, last) with numbers from the distribution, see
+	// detail::generateWithDeferredRejection for how it differs from calling
+	// operator() repeatedly.
+	template <typename RandomIt, typename Generator>
+	void generate(RandomIt first, RandomIt last, Generator& g) {
+		const auto distance = static_cast<UnsignedIntegerType>(m_b - m_a + 1);
+		if (distance == 0) {
+			for (; first != last; ++first) {
+				*first = transposeBack(drawNumber(g));
+			}
+			return;
+		}
+		const auto threshold = ThresholdPolicy::compute(distance);
+		detail::generateWithDeferredRejection(first, last, g, [&](Generator& gen) {
+			const auto x = drawNumber(gen);
+			return detail::BulkCandidate<IntegerType>{
+				transposeBack(static_cast<UnsignedIntegerType>(m_a + (x % distance))), x < threshold };
+		});
+	}
+
+	void save(checkpoint_writer& out) const {
+		out.write(m_a);
+		out.write(m_b);
+	}
+	void restore(checkpoint_reader& in) {
+		const auto a = in.read<UnsignedIntegerType>();
+		const auto b = in.read<UnsignedIntegerType>();
+		m_a = a;
+		m_b = b;
 	}
 };
 
+template <typename IntegerType = std::uint64_t>
 class OpenBSD_reuse {
+	static_assert(std::is_integral<IntegerType>::value, "...");
+
+	using UnsignedIntegerType = Catch::Detail::make_unsigned_t<IntegerType>;
+
 private:
-	std::uint64_t m_a, m_distance, m_threshold;
+	UnsignedIntegerType m_a, m_distance, m_threshold;
 
 	template <typename Generator>
-	uint64_t drawNumber(Generator& g) {
-		return Catch::Detail::fillBitsFrom<uint64_t>(g);
+	UnsignedIntegerType drawNumber(Generator& g) {
+		return Catch::Detail::fillBitsFrom<UnsignedIntegerType>(g);
+	}
+
+	static UnsignedIntegerType transposeTo(IntegerType in) {
+		return Catch::Detail::transposeToNaturalOrder<IntegerType>(static_cast<UnsignedIntegerType>(in));
+	}
+	static IntegerType transposeBack(UnsignedIntegerType in) {
+		return static_cast<IntegerType>(Catch::Detail::transposeToNaturalOrder<IntegerType>(in));
+	}
+
+	static UnsignedIntegerType computeThreshold(UnsignedIntegerType distance) {
+		if (distance == 0) { return 0; }
+		return static_cast<UnsignedIntegerType>(static_cast<UnsignedIntegerType>(-distance) % distance);
 	}
 
 public:
-	using result_type = std::uint64_t;
+	using result_type = IntegerType;
 
-	OpenBSD_reuse(std::uint64_t a, std::uint64_t b) :m_a(a), m_distance(b - m_a + 1), m_threshold((-m_distance) % m_distance) {}
+	OpenBSD_reuse(IntegerType a, IntegerType b) :
+		m_a(transposeTo(a)),
+		m_distance(static_cast<UnsignedIntegerType>(transposeTo(b) - m_a + 1)),
+		m_threshold(computeThreshold(m_distance)) {}
 
 	template <typename Generator>
 	result_type operator()(Generator& g) {
 		if (m_distance == 0) {
-			return drawNumber(g);
+			return transposeBack(drawNumber(g));
 		}
 		// do while?
 		auto x = drawNumber(g);
@@ -152,38 +480,284 @@ public:
 			x = drawNumber(g);
 		}
 
-		return m_a + (x % m_distance);
+		return transposeBack(static_cast<UnsignedIntegerType>(m_a + (x % m_distance)));
+	}
+
+	// Fills [first, last) with numbers from the distribution, see
+	// detail::generateWithDeferredRejection for how it differs from calling
+	// operator() repeatedly.
+	template <typename RandomIt, typename Generator>
+	void generate(RandomIt first, RandomIt last, Generator& g) {
+		const auto distance = m_distance;
+		if (distance == 0) {
+			for (; first != last; ++first) {
+				*first = transposeBack(drawNumber(g));
+			}
+			return;
+		}
+		const auto threshold = m_threshold;
+		detail::generateWithDeferredRejection(first, last, g, [&](Generator& gen) {
+			const auto x = drawNumber(gen);
+			return detail::BulkCandidate<IntegerType>{
+				transposeBack(static_cast<UnsignedIntegerType>(m_a + (x % distance))), x < threshold };
+		});
+	}
+
+	void save(checkpoint_writer& out) const {
+		out.write(m_a);
+		out.write(m_distance);
+		out.write(m_threshold);
+	}
+	void restore(checkpoint_reader& in) {
+		const auto a = in.read<UnsignedIntegerType>();
+		const auto distance = in.read<UnsignedIntegerType>();
+		const auto threshold = in.read<UnsignedIntegerType>();
+		m_a = a;
+		m_distance = distance;
+		m_threshold = threshold;
 	}
 };
 
+template <typename IntegerType = std::uint64_t>
 class OpenBSD_libdivide {
+    static_assert( std::is_integral<IntegerType>::value, "..." );
+
+    using UnsignedIntegerType = Catch::Detail::make_unsigned_t<IntegerType>;
+    using DivisionType = detail::libdivide_operand_t<UnsignedIntegerType>;
+
 private:
-    std::uint64_t m_a, m_distance, m_threshold;
-    libdivide::divider<std::uint64_t> m_divider;
+    UnsignedIntegerType m_a, m_distance, m_threshold;
+    libdivide::divider<DivisionType> m_divider;
 
     template <typename Generator>
-    uint64_t drawNumber( Generator& g ) {
-        return Catch::Detail::fillBitsFrom<uint64_t>( g );
+    UnsignedIntegerType drawNumber( Generator& g ) {
+        return Catch::Detail::fillBitsFrom<UnsignedIntegerType>( g );
     }
 
-	uint64_t takeMod( uint64_t in ) { return in - ( in / m_divider ) * m_distance; }
+    static UnsignedIntegerType transposeTo( IntegerType in ) {
+        return Catch::Detail::transposeToNaturalOrder<IntegerType>( static_cast<UnsignedIntegerType>( in ) );
+    }
+    static IntegerType transposeBack( UnsignedIntegerType in ) {
+        return static_cast<IntegerType>( Catch::Detail::transposeToNaturalOrder<IntegerType>( in ) );
+    }
 
+    static UnsignedIntegerType computeThreshold( UnsignedIntegerType distance ) {
+        if ( distance == 0 ) { return 0; }
+        return static_cast<UnsignedIntegerType>( static_cast<UnsignedIntegerType>( -distance ) % distance );
+    }
 
-public:
-    using result_type = std::uint64_t;
+	UnsignedIntegerType takeMod( UnsignedIntegerType in ) {
+        return static_cast<UnsignedIntegerType>( in - ( DivisionType( in ) / m_divider ) * m_distance );
+    }
 
-    OpenBSD_libdivide( std::uint64_t a, std::uint64_t b ):
-        m_a( a ), m_distance( b - m_a + 1 ), m_threshold( ( -m_distance ) % m_distance ), m_divider(m_distance) {}
+    struct Precomputed {
+        UnsignedIntegerType threshold;
+        libdivide::divider<DivisionType> divider;
+    };
+
+    static Precomputed precompute( UnsignedIntegerType distance ) {
+        return { computeThreshold( distance ), detail::makeDivider( distance ) };
+    }
+
+public:
+    using result_type = IntegerType;
+
+    // Thresholds and dividers cached by distance, see distance-cache.hpp
+    template <std::size_t Slots = 64>
+    using cache_type = distance_cache<UnsignedIntegerType, Precomputed, Slots>;
+
+    OpenBSD_libdivide( IntegerType a, IntegerType b ):
+        m_a( transposeTo( a ) ),
+        m_distance( static_cast<UnsignedIntegerType>( transposeTo( b ) - m_a + 1 ) ),
+        m_threshold( computeThreshold( m_distance ) ),
+        m_divider( detail::makeDivider( m_distance ) ) {}
+
+    // Takes the threshold and the divider from `cache`, instead of
+    // computing them
+    template <std::size_t Slots>
+    OpenBSD_libdivide( IntegerType a, IntegerType b, cache_type<Slots>& cache ):
+        m_a( transposeTo( a ) ),
+        m_distance( static_cast<UnsignedIntegerType>( transposeTo( b ) - m_a + 1 ) ) {
+        const auto& cached = cache.get( m_distance, &precompute );
+        m_threshold = cached.threshold;
+        m_divider = cached.divider;
+    }
 
     template <typename Generator>
     result_type operator()( Generator& g ) {
-        if ( m_distance == 0 ) { return drawNumber( g ); }
+        if ( m_distance == 0 ) { return transposeBack( drawNumber( g ) ); }
         // do while?
         auto x = drawNumber( g );
         while ( x < m_threshold ) {
             x = drawNumber( g );
         }
 
-        return m_a + takeMod( x );
+        return transposeBack( static_cast<UnsignedIntegerType>( m_a + takeMod( x ) ) );
     }
+
+    // Fills [first, last) with numbers from the distribution, see
+    // detail::generateWithDeferredRejection for how it differs from calling
+    // operator() repeatedly. For 32 and 64 bit types, the remainders are
+    // computed a chunk at a time when that pays off, see
+    // detail::generateWithBulkRemainders.
+    template <typename RandomIt, typename Generator>
+    void generate( RandomIt first, RandomIt last, Generator& g ) {
+        if ( m_distance == 0 ) {
+            for ( ; first != last; ++first ) {
+                *first = transposeBack( drawNumber( g ) );
+            }
+            return;
+        }
+        auto finish = [this]( UnsignedIntegerType x, UnsignedIntegerType r ) {
+            return detail::BulkCandidate<IntegerType>{ transposeBack( static_cast<UnsignedIntegerType>( m_a + r ) ),
+                                                       x < m_threshold };
+        };
+        auto attempt = [this, &finish]( Generator& gen ) {
+            const auto x = drawNumber( gen );
+            return finish( x, takeMod( x ) );
+        };
+        // libdivide has no vector dividers for the narrow types
+        if constexpr ( sizeof( UnsignedIntegerType ) >= sizeof( std::uint32_t ) ) {
+            const auto threshold = [this] { return m_threshold; };
+            if ( m_distance > 1 && detail::bulkRemaindersPayOff<Generator>( threshold ) ) {
+                detail::generateWithBulkRemainders<IntegerType>( first, last, g, m_distance, finish, attempt );
+                return;
+            }
+        }
+        detail::generateWithDeferredRejection( first, last, g, attempt );
+    }
+
+    // The divider is rebuilt rather than saved, to keep the checkpoint small
+    void save( checkpoint_writer& out ) const {
+        out.write( m_a );
+        out.write( m_distance );
+        out.write( m_threshold );
+    }
+    void restore( checkpoint_reader& in ) {
+        const auto a = in.read<UnsignedIntegerType>();
+        const auto distance = in.read<UnsignedIntegerType>();
+        const auto threshold = in.read<UnsignedIntegerType>();
+        m_a = a;
+        m_distance = distance;
+        m_threshold = threshold;
+        m_divider = detail::makeDivider( m_distance );
+    }
+};
+
+namespace detail {
+    // All ones up to and including the highest set bit of `in`
+    inline std::uint64_t coveringMask( std::uint64_t in ) {
+        in |= in >> 1;
+        in |= in >> 2;
+        in |= in >> 4;
+        in |= in >> 8;
+        in |= in >> 16;
+        in |= in >> 32;
+        return in;
+    }
+} // namespace detail
+
+// Apple's arc4random_uniform approach: mask the random number down to
+// the smallest power of two that covers the distance, and reject the
+// results that are out of range. There is no multiplication and no
+// division, and if the distance is just below a power of two, almost
+// nothing gets rejected. Just above one, almost half of it does.
+class bitmask_plain {
+private:
+	std::uint64_t m_a, m_b;
+
+	template <typename Generator>
+	uint64_t drawNumber(Generator& g) {
+		return Catch::Detail::fillBitsFrom<uint64_t>(g);
+	}
+
+public:
+	using result_type = std::uint64_t;
+
+	bitmask_plain(std::uint64_t a, std::uint64_t b) :m_a(a), m_b(b) {}
+
+	// The full range does not need special handling, the mask is then
+	// all ones and nothing gets rejected.
+	template <typename Generator>
+	result_type operator()(Generator& g) {
+		const auto range = m_b - m_a;
+		const auto mask = detail::coveringMask(range);
+		auto x = drawNumber(g) & mask;
+		while (x > range) {
+			x = drawNumber(g) & mask;
+		}
+		return m_a + x;
+	}
+
+	// Fills [first, last) with numbers from the distribution, see
+	// detail::generateWithDeferredRejection for how it differs from calling
+	// operator() repeatedly.
+	template <typename RandomIt, typename Generator>
+	void generate(RandomIt first, RandomIt last, Generator& g) {
+		const auto range = m_b - m_a;
+		const auto mask = detail::coveringMask(range);
+		detail::generateWithDeferredRejection(first, last, g, [&](Generator& gen) {
+			const auto x = drawNumber(gen) & mask;
+			return detail::BulkCandidate<std::uint64_t>{ m_a + x, x > range };
+		});
+	}
+
+	void save(checkpoint_writer& out) const {
+		out.write(m_a);
+		out.write(m_b);
+	}
+	void restore(checkpoint_reader& in) {
+		const auto a = in.read<std::uint64_t>();
+		const auto b = in.read<std::uint64_t>();
+		m_a = a;
+		m_b = b;
+	}
+};
+
+class bitmask_reuse {
+private:
+	std::uint64_t m_a, m_range, m_mask;
+
+	template <typename Generator>
+	uint64_t drawNumber(Generator& g) {
+		return Catch::Detail::fillBitsFrom<uint64_t>(g);
+	}
+
+public:
+	using result_type = std::uint64_t;
+
+	bitmask_reuse(std::uint64_t a, std::uint64_t b) :m_a(a), m_range(b - a), m_mask(detail::coveringMask(m_range)) {}
+
+	template <typename Generator>
+	result_type operator()(Generator& g) {
+		auto x = drawNumber(g) & m_mask;
+		while (x > m_range) {
+			x = drawNumber(g) & m_mask;
+		}
+		return m_a + x;
+	}
+
+	// Fills [first, last) with numbers from the distribution, see
+	// detail::generateWithDeferredRejection for how it differs from calling
+	// operator() repeatedly.
+	template <typename RandomIt, typename Generator>
+	void generate(RandomIt first, RandomIt last, Generator& g) {
+		detail::generateWithDeferredRejection(first, last, g, [this](Generator& gen) {
+			const auto x = drawNumber(gen) & m_mask;
+			return detail::BulkCandidate<std::uint64_t>{ m_a + x, x > m_range };
+		});
+	}
+
+	// The mask is rebuilt rather than saved, to keep the checkpoint small
+	void save(checkpoint_writer& out) const {
+		out.write(m_a);
+		out.write(m_range);
+	}
+	void restore(checkpoint_reader& in) {
+		const auto a = in.read<std::uint64_t>();
+		const auto range = in.read<std::uint64_t>();
+		m_a = a;
+		m_range = range;
+		m_mask = detail::coveringMask(m_range);
+	}
 };
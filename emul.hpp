@@ -97,3 +97,99 @@ inline ext_mul_result ext_mul_intrinsic( std::uint64_t lhs, uint64_t rhs ) {
     throw std::runtime_error( "no intrisic available" );
 #endif
 }
+
+#if defined( USE_UINT128 )
+struct ext_mul128_result {
+    __uint128_t upper;
+    __uint128_t lower;
+    friend bool operator==( ext_mul128_result const& lhs, ext_mul128_result const& rhs ) {
+        return lhs.upper == rhs.upper && lhs.lower == rhs.lower;
+    }
+};
+
+// Returns 256 bit result of multiplying lhs and rhs, using the same
+// long multiplication as ext_mul_naive, just with four 32 bit "digits"
+// per operand, and the carries propagated after every digit.
+inline ext_mul128_result ext_mul128_naive( __uint128_t lhs, __uint128_t rhs ) {
+    std::uint64_t lhs_digits[4], rhs_digits[4];
+    for ( int i = 0; i < 4; ++i ) {
+        lhs_digits[i] = static_cast<std::uint32_t>( lhs >> ( 32 * i ) );
+        rhs_digits[i] = static_cast<std::uint32_t>( rhs >> ( 32 * i ) );
+    }
+
+    // Least significant digit first
+    std::uint64_t result[8] = {};
+    for ( int i = 0; i < 4; ++i ) {
+        std::uint64_t carry = 0;
+        for ( int j = 0; j < 4; ++j ) {
+            // Cannot overflow: (2^32 - 1)^2 + 2 * (2^32 - 1) == 2^64 - 1
+            std::uint64_t column = lhs_digits[i] * rhs_digits[j] + result[i + j] + carry;
+            result[i + j] = column & 0xFF'FF'FF'FF;
+            carry = column >> 32;
+        }
+        result[i + 4] = carry;
+    }
+
+    auto join = [&]( int first ) {
+        __uint128_t out = 0;
+        for ( int i = first + 3; i >= first; --i ) {
+            out = ( out << 32 ) | result[i];
+        }
+        return out;
+    };
+    return { join( 4 ), join( 0 ) };
+}
+
+// Splits the operands into 64 bit limbs, and multiplies those with
+// ext_mul_optimized, so it does not need 128 bit arithmetic either.
+inline ext_mul128_result ext_mul128_optimized( __uint128_t lhs, __uint128_t rhs ) {
+    const auto lhs_low = static_cast<std::uint64_t>( lhs );
+    const auto lhs_high = static_cast<std::uint64_t>( lhs >> 64 );
+    const auto rhs_low = static_cast<std::uint64_t>( rhs );
+    const auto rhs_high = static_cast<std::uint64_t>( rhs >> 64 );
+
+    const auto low_low = ext_mul_optimized( lhs_low, rhs_low );
+    const auto low_high = ext_mul_optimized( lhs_low, rhs_high );
+    const auto high_low = ext_mul_optimized( lhs_high, rhs_low );
+    const auto high_high = ext_mul_optimized( lhs_high, rhs_high );
+
+    // Second 64 bit word of the result, the carries out of it go to the third
+    std::uint64_t word1 = low_low.upper + low_high.lower;
+    std::uint64_t carry1 = word1 < low_high.lower;
+    word1 += high_low.lower;
+    carry1 += word1 < high_low.lower;
+
+    std::uint64_t word2 = high_high.lower + carry1;
+    std::uint64_t carry2 = word2 < carry1;
+    word2 += low_high.upper;
+    carry2 += word2 < low_high.upper;
+    word2 += high_low.upper;
+    carry2 += word2 < high_low.upper;
+
+    // high_high.upper + carry2 cannot overflow, as the result fits into 256 bits
+    const std::uint64_t word3 = high_high.upper + carry2;
+
+    return { ( __uint128_t( word3 ) << 64 ) | word2, ( __uint128_t( word1 ) << 64 ) | low_low.lower };
+}
+
+// Same limbs as ext_mul128_optimized, but lets the compiler do
+// the 64x64 -> 128 bit multiplications and the carries.
+inline ext_mul128_result ext_mul128_intrinsic( __uint128_t lhs, __uint128_t rhs ) {
+    const auto lhs_low = static_cast<std::uint64_t>( lhs );
+    const auto lhs_high = static_cast<std::uint64_t>( lhs >> 64 );
+    const auto rhs_low = static_cast<std::uint64_t>( rhs );
+    const auto rhs_high = static_cast<std::uint64_t>( rhs >> 64 );
+
+    const auto low_low = __uint128_t( lhs_low ) * rhs_low;
+    const auto low_high = __uint128_t( lhs_low ) * rhs_high;
+    const auto high_low = __uint128_t( lhs_high ) * rhs_low;
+    const auto high_high = __uint128_t( lhs_high ) * rhs_high;
+
+    // At most 3 * (2^64 - 1), so this fits into 128 bits
+    const __uint128_t middle =
+        ( low_low >> 64 ) + static_cast<std::uint64_t>( low_high ) + static_cast<std::uint64_t>( high_low );
+
+    return { high_high + ( low_high >> 64 ) + ( high_low >> 64 ) + ( middle >> 64 ),
+             ( middle << 64 ) | static_cast<std::uint64_t>( low_low ) };
+}
+#endif
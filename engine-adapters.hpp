@@ -0,0 +1,174 @@
+#pragma once
+
+// Adapters that change how the distributions get bits out of an engine,
+// without changing the engine itself.
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace detail {
+    template <typename Engine, typename = void>
+    struct has_fill : std::false_type {};
+
+    template <typename Engine>
+    struct has_fill<Engine,
+                    decltype( std::declval<Engine&>().fill( std::declval<typename Engine::result_type*>(),
+                                                            std::size_t{} ) )> : std::true_type {};
+
+    // Same as Catch2's fillBitsFrom, but usable in constant expressions,
+    // which Catch2 does not promise.
+    template <typename Target, typename Generator>
+    constexpr Target fillBitsFrom( Generator& gen ) {
+        using gresult_type = typename Generator::result_type;
+        static_assert( std::is_unsigned<Target>::value, "Only unsigned integers are supported" );
+        constexpr auto generated_bits = sizeof( gresult_type ) * CHAR_BIT;
+        constexpr auto return_bits = sizeof( Target ) * CHAR_BIT;
+        if constexpr ( generated_bits >= return_bits ) {
+            return static_cast<Target>( gen() >> ( generated_bits - return_bits ) );
+        } else {
+            Target ret = 0;
+            for ( std::size_t filled_bits = 0; filled_bits < return_bits; filled_bits += generated_bits ) {
+                ret <<= generated_bits;
+                ret |= gen();
+            }
+            return ret;
+        }
+    }
+
+    // Fills `bits` the same way as calling fillBitsFrom `count` times, but
+    // uses the engine's bulk `fill` API where one exists. The engine only
+    // ever writes into buffers of its own result_type, because unsigned
+    // long long and std::uint64_t can be different types of the same size.
+    template <typename UInt, typename Generator>
+    void drawBits( UInt* bits, std::size_t count, Generator& g ) {
+        using gresult_type = typename Generator::result_type;
+        constexpr std::size_t piece = 128;
+        if constexpr ( has_fill<Generator>::value && std::is_same<gresult_type, UInt>::value ) {
+            g.fill( bits, count );
+        } else if constexpr ( has_fill<Generator>::value && sizeof( gresult_type ) == sizeof( UInt ) ) {
+            gresult_type filled[piece];
+            for ( std::size_t done = 0; done < count; done += piece ) {
+                const auto n = count - done < piece ? count - done : piece;
+                g.fill( filled, n );
+                for ( std::size_t i = 0; i < n; ++i ) {
+                    bits[done + i] = filled[i];
+                }
+            }
+        } else if constexpr ( has_fill<Generator>::value && sizeof( gresult_type ) == sizeof( std::uint32_t ) &&
+                              sizeof( UInt ) == sizeof( std::uint64_t ) ) {
+            // fillBitsFrom puts the first output in the upper half
+            gresult_type halves[2 * piece];
+            for ( std::size_t done = 0; done < count; done += piece ) {
+                const auto n = count - done < piece ? count - done : piece;
+                g.fill( halves, 2 * n );
+                for ( std::size_t i = 0; i < n; ++i ) {
+                    bits[done + i] = ( UInt( halves[2 * i] ) << 32 ) | halves[2 * i + 1];
+                }
+            }
+        } else {
+            for ( std::size_t i = 0; i < count; ++i ) {
+                bits[i] = fillBitsFrom<UInt>( g );
+            }
+        }
+    }
+} // namespace detail
+
+// Generates N outputs of the underlying engine at once, so that the state
+// updates run in a tight loop, instead of being interleaved with the
+// distribution's math. Engines with a bulk `fill` API use it to refill.
+//
+// Returns the same sequence as the underlying engine.
+template <typename Engine, std::size_t N>
+class buffered_engine {
+    static_assert( N > 0, "The buffer must hold at least one output" );
+
+public:
+    using result_type = typename Engine::result_type;
+    static constexpr result_type( min )() { return ( Engine::min )(); }
+    static constexpr result_type( max )() { return ( Engine::max )(); }
+
+    buffered_engine(): m_pos( N ) {}
+    explicit buffered_engine( Engine engine ): m_engine( std::move( engine ) ), m_pos( N ) {}
+
+    result_type operator()() {
+        if ( m_pos == N ) { refill(); }
+        return m_buffer[m_pos++];
+    }
+
+private:
+    void refill() {
+        if constexpr ( detail::has_fill<Engine>::value ) {
+            m_engine.fill( m_buffer, N );
+        } else {
+            for ( std::size_t i = 0; i < N; ++i ) {
+                m_buffer[i] = m_engine();
+            }
+        }
+        m_pos = 0;
+    }
+
+    alignas( 64 ) result_type m_buffer[N];
+    Engine m_engine;
+    std::size_t m_pos;
+};
+
+// Keeps the unused bits of a 64 bit engine's output around, and serves
+// requests for narrower numbers out of them. A 64 bit engine feeding
+// a 32 bit distribution then needs one call per two numbers, rather than
+// throwing away half of every output.
+//
+// As with Catch2's fillBitsFrom, the bits are handed out from the top.
+template <typename Engine, typename ResultType = std::uint32_t>
+class bit_pool {
+    using engine_result_type = typename Engine::result_type;
+    static_assert( sizeof( engine_result_type ) == sizeof( std::uint64_t ), "The pool needs 64 bit engine" );
+    static_assert( ( Engine::min )() == 0 && ( Engine::max )() == static_cast<engine_result_type>( -1 ),
+                   "The engine must output all numbers in its result type" );
+
+    static std::uint64_t shiftLeft( std::uint64_t in, unsigned count ) { return count >= 64 ? 0 : in << count; }
+
+public:
+    using result_type = ResultType;
+    static_assert( std::is_unsigned<result_type>::value, "..." );
+    static constexpr result_type( min )() { return 0; }
+    static constexpr result_type( max )() { return static_cast<result_type>( -1 ); }
+
+    bit_pool() = default;
+    explicit bit_pool( Engine engine ): m_engine( std::move( engine ) ) {}
+
+    result_type operator()() { return take<result_type>(); }
+
+    // Returns the next sizeof(UInt) * CHAR_BIT bits from the pool, refilling
+    // it from the engine if there are not enough bits left.
+    template <typename UInt>
+    UInt take() {
+        static_assert( std::is_unsigned<UInt>::value && sizeof( UInt ) <= sizeof( std::uint64_t ), "..." );
+        constexpr unsigned wanted_bits = sizeof( UInt ) * CHAR_BIT;
+
+        if ( m_bits >= wanted_bits ) {
+            const auto result = static_cast<UInt>( m_reservoir >> ( 64 - wanted_bits ) );
+            m_reservoir = shiftLeft( m_reservoir, wanted_bits );
+            m_bits -= wanted_bits;
+            return result;
+        }
+
+        // The leftover bits become the top of the result, and the rest
+        // comes from the top of a fresh output.
+        const unsigned missing_bits = wanted_bits - m_bits;
+        const std::uint64_t fresh = m_engine();
+        const std::uint64_t leftover = m_bits == 0 ? 0 : m_reservoir >> ( 64 - m_bits );
+        const auto result = static_cast<UInt>( shiftLeft( leftover, missing_bits ) | ( fresh >> ( 64 - missing_bits ) ) );
+        m_reservoir = shiftLeft( fresh, missing_bits );
+        m_bits = 64 - missing_bits;
+        return result;
+    }
+
+private:
+    Engine m_engine;
+    std::uint64_t m_reservoir = 0;
+    // How many of the top bits in m_reservoir are unused
+    unsigned m_bits = 0;
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+// Assorted fast 64 bit generators, so that the distributions can be
+// compared with more than just PCG32 as the source of bits.
+
+#include "emul.hpp"
+
+#include <cstdint>
+
+inline std::uint64_t rotate_left64( std::uint64_t val, unsigned count ) {
+    return ( val << count ) | ( val >> ( 64 - count ) );
+}
+
+// Used to expand a single seed into the larger state of other generators,
+// as recommended by the xoshiro authors.
+inline std::uint64_t splitmix64( std::uint64_t& state ) {
+    std::uint64_t z = ( state += 0x9e3779b97f4a7c15ULL );
+    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+    return z ^ ( z >> 31 );
+}
+
+// Blackman & Vigna, https://prng.di.unimi.it/xoshiro256plusplus.c
+class Xoshiro256PlusPlus {
+public:
+    using result_type = std::uint64_t;
+    static constexpr result_type( min )() { return 0; }
+    static constexpr result_type( max )() { return static_cast<result_type>( -1 ); }
+
+    Xoshiro256PlusPlus(): Xoshiro256PlusPlus( 0xed743cc4U ) {}
+
+    explicit Xoshiro256PlusPlus( std::uint64_t seed_ ) { seed( seed_ ); }
+
+    // Uses the state as given, it must not be all zeros
+    Xoshiro256PlusPlus( std::uint64_t s0, std::uint64_t s1, std::uint64_t s2, std::uint64_t s3 ):
+        m_state{ s0, s1, s2, s3 } {}
+
+    void seed( std::uint64_t seed_ ) {
+        for ( auto& s : m_state ) {
+            s = splitmix64( seed_ );
+        }
+    }
+
+    result_type operator()() {
+        const std::uint64_t result = rotate_left64( m_state[0] + m_state[3], 23 ) + m_state[0];
+        const std::uint64_t t = m_state[1] << 17;
+
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = rotate_left64( m_state[3], 45 );
+
+        return result;
+    }
+
+private:
+    std::uint64_t m_state[4];
+};
+
+// Chris Doty-Humphrey's Small Fast Chaotic generator, from PractRand
+class Sfc64 {
+public:
+    using result_type = std::uint64_t;
+    static constexpr result_type( min )() { return 0; }
+    static constexpr result_type( max )() { return static_cast<result_type>( -1 ); }
+
+    Sfc64(): Sfc64( 0xed743cc4U ) {}
+
+    explicit Sfc64( std::uint64_t seed_ ) { seed( seed_ ); }
+
+    void seed( std::uint64_t seed_ ) {
+        m_a = m_b = m_c = seed_;
+        m_counter = 1;
+        // The same warm up as PractRand uses
+        for ( int i = 0; i < 12; ++i ) {
+            ( *this )();
+        }
+    }
+
+    result_type operator()() {
+        const std::uint64_t tmp = m_a + m_b + m_counter++;
+        m_a = m_b ^ ( m_b >> 11 );
+        m_b = m_c + ( m_c << 3 );
+        m_c = rotate_left64( m_c, 24 ) + tmp;
+        return tmp;
+    }
+
+private:
+    std::uint64_t m_a, m_b, m_c, m_counter;
+};
+
+// Wang Yi's wyrand, https://github.com/wangyi-fudan/wyhash
+class WyRand {
+public:
+    using result_type = std::uint64_t;
+    static constexpr result_type( min )() { return 0; }
+    static constexpr result_type( max )() { return static_cast<result_type>( -1 ); }
+
+    WyRand(): WyRand( 0xed743cc4U ) {}
+
+    explicit WyRand( std::uint64_t seed_ ): m_state( seed_ ) {}
+
+    void seed( std::uint64_t seed_ ) { m_state = seed_; }
+
+    result_type operator()() {
+        m_state += 0xa0761d6478bd642fULL;
+#if defined( USE_UINT128 ) || defined( USE_MSVC_UMUL )
+        const auto product = ext_mul_intrinsic( m_state, m_state ^ 0xe7037ed1a0b428dbULL );
+#else
+        const auto product = ext_mul_optimized( m_state, m_state ^ 0xe7037ed1a0b428dbULL );
+#endif
+        return product.upper ^ product.lower;
+    }
+
+private:
+    std::uint64_t m_state;
+};
+
+#if defined( USE_UINT128 )
+// Multiplicative congruential generator with 128 bit state, returning the
+// upper half of the state. The multiplier is from Steele & Vigna's
+// "Computationally easy, spectrally good multipliers".
+class Lehmer128 {
+public:
+    using result_type = std::uint64_t;
+    static constexpr result_type( min )() { return 0; }
+    static constexpr result_type( max )() { return static_cast<result_type>( -1 ); }
+
+    Lehmer128(): Lehmer128( 0xed743cc4U ) {}
+
+    explicit Lehmer128( std::uint64_t seed_ ) { seed( seed_ ); }
+
+    void seed( std::uint64_t seed_ ) {
+        const std::uint64_t upper = splitmix64( seed_ );
+        const std::uint64_t lower = splitmix64( seed_ );
+        // MCG state must be odd
+        m_state = ( __uint128_t( upper ) << 64 ) | lower | 1;
+    }
+
+    result_type operator()() {
+        m_state *= 0xda942042e4dd58b5ULL;
+        return static_cast<result_type>( m_state >> 64 );
+    }
+
+private:
+    __uint128_t m_state;
+};
+#endif
@@ -1,9 +1,22 @@
 #pragma once
 
 // Yoinked straight from Catch2's PCG, but all functions are visible
+#include <cstddef>
 #include <cstdint>
 
-inline uint32_t rotate_right(uint32_t val, uint32_t count) {
+#include "checkpoint.hpp"
+#include "generators.hpp"
+
+#if defined( __SIZEOF_INT128__ )
+#    define PCG_USE_UINT128
+#endif
+
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#    include <immintrin.h>
+#    define PCG_USE_AVX2_DISPATCH
+#endif
+
+constexpr uint32_t rotate_right(uint32_t val, uint32_t count) {
     const uint32_t mask = 31;
     count &= mask;
     return (val >> count) | (val << (-count & mask));
@@ -13,6 +26,8 @@ class SimplePcg32 {
     using state_type = std::uint64_t;
 public:
     using result_type = std::uint32_t;
+    static constexpr std::uint64_t default_stream = 0x13ed0cc53f939476ULL;
+
     static constexpr result_type(min)() {
         return 0;
     }
@@ -21,34 +36,441 @@ public:
     }
 
     // Provide some default initial state for the default constructor
-    SimplePcg32() :SimplePcg32(0xed743cc4U) {}
+    constexpr SimplePcg32() :SimplePcg32(0xed743cc4U) {}
+
+    explicit constexpr SimplePcg32(result_type seed_) :SimplePcg32(seed_, default_stream) {}
 
-    explicit SimplePcg32(result_type seed_) {
+    // Different streams are different sequences, even with the same seed.
+    // Only the lower 63 bits of the stream are used.
+    constexpr SimplePcg32(result_type seed_, std::uint64_t stream) :
+        m_state(0), m_inc((stream << 1ULL) | 1ULL) {
         seed(seed_);
     }
 
-    void seed(result_type seed_) {
+    constexpr void seed(result_type seed_) {
         m_state = 0;
         (*this)();
         m_state += seed_;
         (*this)();
     }
 
-    result_type operator()() {
+    constexpr result_type operator()() {
         // prepare the output value
         const uint32_t xorshifted = static_cast<uint32_t>(((m_state >> 18u) ^ m_state) >> 27u);
         const auto output = rotate_right(xorshifted, m_state >> 59u);
 
         // advance state
-        m_state = m_state * 6364136223846793005ULL + s_inc;
+        m_state = m_state * s_mult + m_inc;
 
         return output;
     }
 
+    // Moves the generator `delta` steps forward in O(log delta) steps,
+    // using Brown's "Random number generation with arbitrary strides".
+    // The state space wraps around, so advance(-delta) moves backwards.
+    constexpr void advance(std::uint64_t delta) {
+        std::uint64_t acc_mult = 1;
+        std::uint64_t acc_plus = 0;
+        std::uint64_t cur_mult = s_mult;
+        std::uint64_t cur_plus = m_inc;
+        while (delta > 0) {
+            if (delta & 1) {
+                acc_mult *= cur_mult;
+                acc_plus = acc_plus * cur_mult + cur_plus;
+            }
+            cur_plus = (cur_mult + 1) * cur_plus;
+            cur_mult *= cur_mult;
+            delta >>= 1;
+        }
+        m_state = acc_mult * m_state + acc_plus;
+    }
+
+    constexpr void discard(unsigned long long n) {
+        advance(n);
+    }
+
+    void save(checkpoint_writer& out) const {
+        out.write(m_state);
+        out.write(m_inc);
+    }
+    void restore(checkpoint_reader& in) {
+        const auto state = in.read<std::uint64_t>();
+        const auto inc = in.read<std::uint64_t>();
+        m_state = state;
+        m_inc = inc;
+    }
+
+    friend constexpr bool operator==(SimplePcg32 const& lhs, SimplePcg32 const& rhs) {
+        return lhs.m_state == rhs.m_state && lhs.m_inc == rhs.m_inc;
+    }
+    friend constexpr bool operator!=(SimplePcg32 const& lhs, SimplePcg32 const& rhs) {
+        return !(lhs == rhs);
+    }
+
 private:
-    // In theory we also need operator<< and operator>>, operator==, etc
-    // In practice we do not use them, so we will skip them for now
+    // In theory we also need the textual operator<< and operator>>,
+    // in practice we only need the binary save/restore above.
+
+    static constexpr std::uint64_t s_mult = 6364136223846793005ULL;
 
     std::uint64_t m_state;
-    static const std::uint64_t s_inc = (0x13ed0cc53f939476ULL << 1ULL) | 1ULL;
+    std::uint64_t m_inc;
+};
+
+
+#if defined( PCG_USE_UINT128 )
+// PCG64 with the DXSM output function and the "cheap multiplier", as in
+// numpy's PCG64DXSM. The output is computed from the state before the
+// update, so the multiply in the output function and the multiply in the
+// state update can run in parallel.
+class SimplePcg64 {
+    using state_type = __uint128_t;
+public:
+    using result_type = std::uint64_t;
+    // PCG's default 128 bit increment, without the always-set lowest bit
+    static constexpr state_type default_stream =
+        ((state_type(6364136223846793005ULL) << 64) | 1442695040888963407ULL) >> 1;
+
+    static constexpr result_type(min)() {
+        return 0;
+    }
+    static constexpr result_type(max)() {
+        return static_cast<result_type>(-1);
+    }
+
+    // Provide some default initial state for the default constructor
+    SimplePcg64() :SimplePcg64(0xcafef00dd15ea5e5ULL) {}
+
+    explicit SimplePcg64(result_type seed_) :SimplePcg64(seed_, default_stream) {}
+
+    // Only the lower 127 bits of the stream are used.
+    SimplePcg64(result_type seed_, state_type stream) :
+        m_inc((stream << 1) | 1) {
+        seed(seed_);
+    }
+
+    void seed(result_type seed_) {
+        m_state = 0;
+        (*this)();
+        m_state += seed_;
+        (*this)();
+    }
+
+    result_type operator()() {
+        std::uint64_t hi = static_cast<std::uint64_t>(m_state >> 64);
+        const std::uint64_t lo = static_cast<std::uint64_t>(m_state) | 1;
+
+        hi ^= hi >> 32;
+        hi *= s_cheap_mult;
+        hi ^= hi >> 48;
+        hi *= lo;
+
+        m_state = m_state * s_cheap_mult + m_inc;
+
+        return hi;
+    }
+
+private:
+    static constexpr std::uint64_t s_cheap_mult = 0xda942042e4dd58b5ULL;
+
+    state_type m_state;
+    state_type m_inc;
+};
+#endif
+
+// Runs 8 independent PCG32 streams side by side, so that the state updates
+// do not form a single serial dependency chain. Lane i uses the same output
+// function as SimplePcg32, but its own stream and start state, see
+// laneEngine for the SimplePcg32 that generates the same sequence.
+//
+// The outputs are interleaved, so output 8*k + i is the k-th output of lane i.
+// The AVX2 and the scalar paths generate the exact same sequence, the AVX2 path
+// is picked at runtime if the CPU supports it.
+class MultiLanePcg32 {
+    using state_type = std::uint64_t;
+public:
+    using result_type = std::uint32_t;
+    static constexpr std::size_t lanes = 8;
+
+    static constexpr result_type(min)() {
+        return 0;
+    }
+    static constexpr result_type(max)() {
+        return static_cast<result_type>(-1);
+    }
+
+    MultiLanePcg32() :MultiLanePcg32(0xed743cc4U) {}
+
+    explicit MultiLanePcg32(result_type seed_) {
+        seed(seed_);
+    }
+
+    void seed(result_type seed_) {
+        for (std::size_t i = 0; i < lanes; ++i) {
+            const auto lane = laneParameters(seed_, i);
+            m_inc[i] = (lane.stream << 1ULL) | 1ULL;
+            m_state[i] = 0;
+            m_state[i] = m_state[i] * s_mult + m_inc[i];
+            m_state[i] += lane.seed;
+            m_state[i] = m_state[i] * s_mult + m_inc[i];
+        }
+        m_buffer_pos = buffer_size;
+    }
+
+    // The SimplePcg32 that generates the same sequence as lane `lane`
+    // of MultiLanePcg32(seed_)
+    static SimplePcg32 laneEngine(result_type seed_, std::size_t lane) {
+        const auto parameters = laneParameters(seed_, lane);
+        return SimplePcg32(parameters.seed, parameters.stream);
+    }
+
+    result_type operator()() {
+        if (m_buffer_pos == buffer_size) {
+            generateBlocks(m_buffer, buffer_size / lanes);
+            m_buffer_pos = 0;
+        }
+        return m_buffer[m_buffer_pos++];
+    }
+
+    // Writes the next `count` outputs into `out`, as if by calling
+    // operator() `count` times.
+    void fill(result_type* out, std::size_t count) {
+        while (count > 0 && m_buffer_pos != buffer_size) {
+            *out++ = m_buffer[m_buffer_pos++];
+            --count;
+        }
+        const std::size_t blocks = count / lanes;
+        generateBlocks(out, blocks);
+        out += blocks * lanes;
+        count -= blocks * lanes;
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i] = (*this)();
+        }
+    }
+
+    // Exposed so that tests can check that both paths agree.
+    void generateBlocksScalar(result_type* out, std::size_t blocks) {
+        for (std::size_t b = 0; b < blocks; ++b) {
+            for (std::size_t i = 0; i < lanes; ++i) {
+                const auto state = m_state[i];
+                const uint32_t xorshifted = static_cast<uint32_t>(((state >> 18u) ^ state) >> 27u);
+                out[b * lanes + i] = rotate_right(xorshifted, static_cast<uint32_t>(state >> 59u));
+                m_state[i] = state * s_mult + m_inc[i];
+            }
+        }
+    }
+
+#if defined( PCG_USE_AVX2_DISPATCH )
+    __attribute__((target("avx2")))
+    void generateBlocksAVX2(result_type* out, std::size_t blocks) {
+        __m256i state_a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_state));
+        __m256i state_b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_state + 4));
+        const __m256i inc_a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_inc));
+        const __m256i inc_b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_inc + 4));
+
+        for (std::size_t b = 0; b < blocks; ++b) {
+            const __m256i out_a = outputAVX2(state_a);
+            const __m256i out_b = outputAVX2(state_b);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + b * lanes),
+                                _mm256_permute2x128_si256(out_a, out_b, 0x20));
+            state_a = advanceAVX2(state_a, inc_a);
+            state_b = advanceAVX2(state_b, inc_b);
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(m_state), state_a);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(m_state + 4), state_b);
+    }
+#endif
+
+private:
+    struct LaneParameters {
+        result_type seed;
+        std::uint64_t stream;
+    };
+
+    // Lanes with the same start state, whose increments differ by a small
+    // constant, stay a fixed distance apart, so their outputs are strongly
+    // correlated. Both are mixed out of seed_ + lane by SplitMix64 instead.
+    static LaneParameters laneParameters(result_type seed_, std::size_t lane) {
+        std::uint64_t mix = std::uint64_t(seed_) + lane;
+        const auto stream = splitmix64(mix);
+        const auto seed = static_cast<result_type>(splitmix64(mix) >> 32);
+        return { seed, stream };
+    }
+
+    static constexpr std::uint64_t s_mult = 6364136223846793005ULL;
+    static constexpr std::size_t buffer_size = 8 * lanes;
+
+#if defined( PCG_USE_AVX2_DISPATCH )
+    // The output function only ever looks at 32 bits, so we can compute
+    // it in 64 bit lanes and keep just the low half. The results end up
+    // packed in the lower 128 bits.
+    __attribute__((target("avx2")))
+    static inline __m256i outputAVX2(__m256i state) {
+        const __m256i low_mask = _mm256_set1_epi64x(0xFFFF'FFFF);
+        const __m256i thirty_two = _mm256_set1_epi64x(32);
+        const __m256i pack_idx = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+        __m256i xorshifted = _mm256_srli_epi64(_mm256_xor_si256(_mm256_srli_epi64(state, 18), state), 27);
+        xorshifted = _mm256_and_si256(xorshifted, low_mask);
+        const __m256i rot = _mm256_srli_epi64(state, 59);
+        const __m256i rotated = _mm256_or_si256(_mm256_srlv_epi64(xorshifted, rot),
+                                                _mm256_sllv_epi64(xorshifted, _mm256_sub_epi64(thirty_two, rot)));
+        return _mm256_permutevar8x32_epi32(rotated, pack_idx);
+    }
+
+    // There is no 64x64 bit multiply in AVX2, so we build the lower half
+    // of the product from 32x32 bit partial products.
+    __attribute__((target("avx2")))
+    static inline __m256i advanceAVX2(__m256i state, __m256i inc) {
+        const __m256i mult_lo = _mm256_set1_epi64x(static_cast<long long>(s_mult & 0xFFFF'FFFF));
+        const __m256i mult_hi = _mm256_set1_epi64x(static_cast<long long>(s_mult >> 32));
+
+        const __m256i low_low = _mm256_mul_epu32(state, mult_lo);
+        const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(state, 32), mult_lo),
+                                               _mm256_mul_epu32(state, mult_hi));
+        return _mm256_add_epi64(_mm256_add_epi64(low_low, _mm256_slli_epi64(cross, 32)), inc);
+    }
+#endif
+
+
+    static bool hasAVX2() {
+#if defined( PCG_USE_AVX2_DISPATCH )
+        static const bool has_avx2 = __builtin_cpu_supports("avx2");
+        return has_avx2;
+#else
+        return false;
+#endif
+    }
+
+    void generateBlocks(result_type* out, std::size_t blocks) {
+#if defined( PCG_USE_AVX2_DISPATCH )
+        if (hasAVX2()) {
+            generateBlocksAVX2(out, blocks);
+            return;
+        }
+#endif
+        generateBlocksScalar(out, blocks);
+    }
+
+    std::uint64_t m_state[lanes];
+    std::uint64_t m_inc[lanes];
+    result_type m_buffer[buffer_size];
+    std::size_t m_buffer_pos;
+};
+
+// Counter-based Philox4x32-10 from Salmon et al., "Parallel Random Numbers:
+// As Easy as 1, 2, 3". Every block of 4 outputs is a pure function of
+// the key and the block's counter, so the generator can jump to any
+// output index in O(1).
+//
+// The lower 64 bits of the counter are the block index, the upper 64 bits
+// are the stream, so each (key, stream) pair is one sequence of 2^66 outputs.
+class Philox4x32 {
+public:
+    using result_type = std::uint32_t;
+    static constexpr std::size_t words_per_block = 4;
+
+    static constexpr result_type(min)() {
+        return 0;
+    }
+    static constexpr result_type(max)() {
+        return static_cast<result_type>(-1);
+    }
+
+    // Provide some default initial state for the default constructor
+    Philox4x32() :Philox4x32(0xed743cc4U) {}
+
+    explicit Philox4x32(std::uint64_t key, std::uint64_t stream = 0) :
+        m_key{ static_cast<std::uint32_t>(key), static_cast<std::uint32_t>(key >> 32) },
+        m_stream(stream) {
+        seek(0);
+    }
+
+    result_type operator()() {
+        if (m_buffer_pos == words_per_block) {
+            generateBlock(m_key, m_block++, m_stream, m_buffer);
+            m_buffer_pos = 0;
+        }
+        return m_buffer[m_buffer_pos++];
+    }
+
+    // Positions the generator so that the next output is the output with
+    // the given index.
+    void seek(std::uint64_t index) {
+        m_block = index / words_per_block;
+        m_buffer_pos = words_per_block;
+        const auto offset = index % words_per_block;
+        if (offset != 0) {
+            generateBlock(m_key, m_block++, m_stream, m_buffer);
+            m_buffer_pos = offset;
+        }
+    }
+
+    // Index of the next output
+    std::uint64_t position() const {
+        return m_block * words_per_block - (words_per_block - m_buffer_pos);
+    }
+
+    void discard(unsigned long long n) {
+        seek(position() + n);
+    }
+
+    // Writes the next `count` outputs into `out`, as if by calling
+    // operator() `count` times.
+    void fill(result_type* out, std::size_t count) {
+        while (count > 0 && m_buffer_pos != words_per_block) {
+            *out++ = m_buffer[m_buffer_pos++];
+            --count;
+        }
+        const std::size_t blocks = count / words_per_block;
+        for (std::size_t b = 0; b < blocks; ++b) {
+            generateBlock(m_key, m_block++, m_stream, out + b * words_per_block);
+        }
+        out += blocks * words_per_block;
+        count -= blocks * words_per_block;
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i] = (*this)();
+        }
+    }
+
+    // The Philox4x32-10 bijection itself. Writes the 4 outputs of block
+    // `block` from the given stream into `out`.
+    static void generateBlock(const std::uint32_t (&key)[2],
+                              std::uint64_t block,
+                              std::uint64_t stream,
+                              result_type* out) {
+        std::uint32_t ctr[4] = { static_cast<std::uint32_t>(block),
+                                 static_cast<std::uint32_t>(block >> 32),
+                                 static_cast<std::uint32_t>(stream),
+                                 static_cast<std::uint32_t>(stream >> 32) };
+        std::uint32_t k0 = key[0];
+        std::uint32_t k1 = key[1];
+        for (int round = 0; round < 10; ++round) {
+            const std::uint64_t prod0 = std::uint64_t(s_mult0) * ctr[0];
+            const std::uint64_t prod1 = std::uint64_t(s_mult1) * ctr[2];
+            const std::uint32_t next[4] = {
+                static_cast<std::uint32_t>(prod1 >> 32) ^ ctr[1] ^ k0,
+                static_cast<std::uint32_t>(prod1),
+                static_cast<std::uint32_t>(prod0 >> 32) ^ ctr[3] ^ k1,
+                static_cast<std::uint32_t>(prod0),
+            };
+            ctr[0] = next[0]; ctr[1] = next[1]; ctr[2] = next[2]; ctr[3] = next[3];
+            k0 += s_weyl0;
+            k1 += s_weyl1;
+        }
+        out[0] = ctr[0]; out[1] = ctr[1]; out[2] = ctr[2]; out[3] = ctr[3];
+    }
+
+private:
+    static constexpr std::uint32_t s_mult0 = 0xD2511F53;
+    static constexpr std::uint32_t s_mult1 = 0xCD9E8D57;
+    static constexpr std::uint32_t s_weyl0 = 0x9E3779B9;
+    static constexpr std::uint32_t s_weyl1 = 0xBB67AE85;
+
+    std::uint32_t m_key[2];
+    std::uint64_t m_stream;
+    std::uint64_t m_block;
+    result_type m_buffer[words_per_block];
+    std::size_t m_buffer_pos;
 };
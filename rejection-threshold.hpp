@@ -0,0 +1,131 @@
+#pragma once
+
+// Policies for computing the rejection threshold, 2^N % distance, where N
+// is the width of the unsigned type. Distributions that compute it on every
+// call, or that are constructed for a single number, take one as template
+// parameter. `distance` must not be 0 for either of them.
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// Computes the threshold with a hardware division, which costs 35-90
+// cycles for 64 bit numbers on older x86 cores.
+struct division_threshold {
+    template <typename UInt>
+    static constexpr UInt compute( UInt distance ) {
+        static_assert( std::is_unsigned<UInt>::value, "..." );
+        // The cast keeps 8 and 16 bit types from being promoted to a negative int
+        return static_cast<UInt>( ~distance + 1 ) % distance;
+    }
+};
+
+namespace detail {
+    // Returns x % d without an integer division. The quotient is estimated
+    // by a floating point division, which is within one of the real quotient
+    // as long as it is below 2^51, and then corrected. x must also be exactly
+    // representable as a double.
+    constexpr std::uint64_t modWithoutDivision( std::uint64_t x, std::uint32_t d ) {
+        // Going through signed types keeps the conversions single instructions
+        const auto quotient = static_cast<std::uint64_t>( static_cast<std::int64_t>(
+            static_cast<double>( static_cast<std::int64_t>( x ) ) / static_cast<double>( d ) ) );
+        const std::uint64_t product = quotient * d;
+        // The rounded quotient can only be one too large
+        return product > x ? x - product + d : x - product;
+    }
+} // namespace detail
+
+// Computes the threshold with floating point divisions, for distances that
+// fit into 32 bits. For 64 bit types, 2^64 % d is computed as
+// ((2^32 % d) * 2^32) % d, so that the numerator stays exact. Larger
+// distances fall back to the hardware division.
+struct reciprocal_threshold {
+    template <typename UInt>
+    static constexpr UInt compute( UInt distance ) {
+        static_assert( std::is_unsigned<UInt>::value, "..." );
+        constexpr std::uint64_t two_to_32 = std::uint64_t( 1 ) << 32;
+        if constexpr ( sizeof( UInt ) < sizeof( std::uint64_t ) ) {
+            constexpr std::uint64_t two_to_n = std::uint64_t( 1 ) << ( sizeof( UInt ) * 8 );
+            return static_cast<UInt>( detail::modWithoutDivision( two_to_n, distance ) );
+        } else {
+            if ( distance >= two_to_32 ) { return division_threshold::compute( distance ); }
+            const auto narrow = static_cast<std::uint32_t>( distance );
+            return detail::modWithoutDivision( detail::modWithoutDivision( two_to_32, narrow ) << 32, narrow );
+        }
+    }
+};
+
+namespace detail {
+    // Thresholds for the distances 1 to 65536, or up to the largest
+    // distance UInt can hold, indexed by distance - 1. A threshold is
+    // always smaller than its distance, so 16 bits per entry are enough,
+    // and the whole table takes 128 kB.
+    //
+    // The table is generated in chunks of 1024 entries, each of which is
+    // a constant expression on its own. Generating all of it at once takes
+    // more evaluation steps than compilers allow by default, e.g. MSVC
+    // stops at 100000.
+    template <typename UInt>
+    struct SmallThresholdTable {
+        static constexpr std::size_t size = sizeof( UInt ) > 2 ? 65536 : static_cast<UInt>( -1 );
+        static constexpr std::size_t chunk_size = 1024;
+        static constexpr std::size_t chunk_count = ( size + chunk_size - 1 ) / chunk_size;
+        const std::uint16_t* chunks[chunk_count];
+
+        constexpr std::uint16_t operator[]( std::size_t index ) const {
+            return chunks[index / chunk_size][index % chunk_size];
+        }
+    };
+
+    // The last chunk only holds the distances that are left
+    template <typename UInt, std::size_t Chunk>
+    struct SmallThresholdChunk {
+        using table_type = SmallThresholdTable<UInt>;
+        static constexpr std::size_t first = Chunk * table_type::chunk_size;
+        static constexpr std::size_t size =
+            table_type::size - first < table_type::chunk_size ? table_type::size - first : table_type::chunk_size;
+        std::uint16_t thresholds[size];
+    };
+
+    template <typename UInt, std::size_t Chunk>
+    constexpr SmallThresholdChunk<UInt, Chunk> makeSmallThresholdChunk() {
+        SmallThresholdChunk<UInt, Chunk> chunk{};
+        for ( std::size_t i = 0; i < chunk.size; ++i ) {
+            chunk.thresholds[i] =
+                static_cast<std::uint16_t>( division_threshold::compute( static_cast<UInt>( chunk.first + i + 1 ) ) );
+        }
+        return chunk;
+    }
+
+    template <typename UInt, std::size_t Chunk>
+    inline constexpr SmallThresholdChunk<UInt, Chunk> small_threshold_chunk = makeSmallThresholdChunk<UInt, Chunk>();
+
+    template <typename UInt, std::size_t... Chunks>
+    constexpr SmallThresholdTable<UInt> makeSmallThresholdTable( std::index_sequence<Chunks...> ) {
+        return { { small_threshold_chunk<UInt, Chunks>.thresholds... } };
+    }
+
+    // Generated at compile time, and only emitted for the types that use it
+    template <typename UInt>
+    inline constexpr SmallThresholdTable<UInt> small_thresholds =
+        makeSmallThresholdTable<UInt>( std::make_index_sequence<SmallThresholdTable<UInt>::chunk_count>{} );
+} // namespace detail
+
+// Looks the threshold up in a table for distances up to 65536, which is
+// what shuffles of small arrays and random picks from them need, and
+// uses Fallback for the larger ones. The table lookup is a load instead
+// of a division, but it only stays cheap while the part of the table
+// that gets used stays in the cache.
+template <typename Fallback = division_threshold>
+struct small_table_threshold {
+    template <typename UInt>
+    static constexpr UInt compute( UInt distance ) {
+        static_assert( std::is_unsigned<UInt>::value, "..." );
+        using table_type = detail::SmallThresholdTable<UInt>;
+        if ( static_cast<std::size_t>( distance ) <= table_type::size ) {
+            return detail::small_thresholds<UInt>[distance - 1];
+        }
+        return Fallback::compute( distance );
+    }
+};